@@ -0,0 +1,205 @@
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2022 Livox. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+
+// Runs the hot path microbenchmarks and reports them as a table for people, or as JSON or
+// CSV for a regression job to compare against a baseline.
+//
+// options: --format=text|json|csv  --output=path  --filter=substring  --min-time=seconds
+
+#ifndef LIVOX_ROS_DRIVER_BENCHMARK_REPORT_H_
+#define LIVOX_ROS_DRIVER_BENCHMARK_REPORT_H_
+
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+namespace livox_ros {
+
+struct BenchmarkResult {
+  std::string name;
+  uint64_t iterations;
+  uint64_t items;      /**< points, frames or lookups over all iterations */
+  uint64_t bytes;      /**< bytes processed over all iterations, 0 when not meaningful */
+  double seconds;
+};
+
+class BenchmarkReport {
+ public:
+  explicit BenchmarkReport(const char* suite) : suite_(suite) {}
+
+  bool ParseArgs(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+      const char* arg = argv[i];
+      if (strncmp(arg, "--format=", 9) == 0) {
+        format_ = arg + 9;
+      } else if (strncmp(arg, "--output=", 9) == 0) {
+        output_ = arg + 9;
+      } else if (strncmp(arg, "--filter=", 9) == 0) {
+        filter_ = arg + 9;
+      } else if (strncmp(arg, "--min-time=", 11) == 0) {
+        min_time_ = atof(arg + 11);
+      } else {
+        fprintf(stderr, "usage: %s [--format=text|json|csv] [--output=path] [--filter=substring] "
+                "[--min-time=seconds]\n", argv[0]);
+        return false;
+      }
+    }
+    if (format_ != "text" && format_ != "json" && format_ != "csv") {
+      fprintf(stderr, "unknown format: %s\n", format_.c_str());
+      return false;
+    }
+    if (min_time_ <= 0.0) {
+      min_time_ = kDefaultMinTime;
+    }
+    if (format_ != "text" && output_.empty()) {
+      // keep the report alone on stdout, the driver code prints its own logs there
+      report_file_ = fdopen(dup(STDOUT_FILENO), "w");
+      dup2(STDERR_FILENO, STDOUT_FILENO);
+    }
+    return true;
+  }
+
+  void AddContext(const std::string& key, const std::string& value) {
+    context_.emplace_back(key, value);
+  }
+
+  bool Selected(const std::string& name) const {
+    return filter_.empty() || name.find(filter_) != std::string::npos;
+  }
+
+  /**
+   * Times body, which processes items_per_call items and bytes_per_call bytes, for at least
+   * the minimum time. Calls are batched so the clock is read once per batch.
+   */
+  template <typename Body>
+  void Run(const std::string& name, uint64_t items_per_call, uint64_t bytes_per_call, Body body) {
+    if (!Selected(name)) {
+      return;
+    }
+    body();  // warm up caches and buffers
+
+    uint64_t calls = 0;
+    uint64_t batch = 1;
+    double seconds = 0.0;
+    auto start = std::chrono::steady_clock::now();
+    while (seconds < min_time_) {
+      for (uint64_t i = 0; i < batch; i++) {
+        body();
+      }
+      calls += batch;
+      batch *= 2;
+      seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    BenchmarkResult result = {name, calls, calls * items_per_call, calls * bytes_per_call, seconds};
+    results_.push_back(result);
+    if (format_ == "text") {
+      PrintText(stdout, result);
+    }
+  }
+
+  /** writes the json or csv report, the text report is printed as the benchmarks run */
+  bool Finish() {
+    if (format_ == "text" && output_.empty()) {
+      return true;
+    }
+    FILE* file = output_.empty() ? report_file_ : fopen(output_.c_str(), "w");
+    if (file == nullptr) {
+      fprintf(stderr, "can not open %s\n", output_.c_str());
+      return false;
+    }
+    if (format_ == "json") {
+      WriteJson(file);
+    } else if (format_ == "csv") {
+      WriteCsv(file);
+    } else {
+      for (const auto& result : results_) {
+        PrintText(file, result);
+      }
+    }
+    fclose(file);
+    return true;
+  }
+
+ private:
+  static constexpr double kDefaultMinTime = 0.2;
+
+  static double PerSecond(uint64_t count, double seconds) {
+    return (seconds > 0.0) ? count / seconds : 0.0;
+  }
+
+  void PrintText(FILE* file, const BenchmarkResult& result) {
+    fprintf(file, "%-40s %12.3f Mitems/s %10.1f MB/s %10.2f ns/item\n", result.name.c_str(),
+            PerSecond(result.items, result.seconds) / 1e6,
+            PerSecond(result.bytes, result.seconds) / 1e6,
+            result.items ? result.seconds * 1e9 / result.items : 0.0);
+  }
+
+  void WriteJson(FILE* file) {
+    fprintf(file, "{\n  \"suite\": \"%s\",\n  \"context\": {", suite_.c_str());
+    for (size_t i = 0; i < context_.size(); i++) {
+      fprintf(file, "%s\"%s\": \"%s\"", i ? ", " : "", context_[i].first.c_str(),
+              context_[i].second.c_str());
+    }
+    fprintf(file, "},\n  \"results\": [\n");
+    for (size_t i = 0; i < results_.size(); i++) {
+      const BenchmarkResult& r = results_[i];
+      fprintf(file, "    {\"name\": \"%s\", \"iterations\": %" PRIu64 ", \"seconds\": %.6f, "
+              "\"items_per_second\": %.1f, \"bytes_per_second\": %.1f, \"ns_per_item\": %.4f}%s\n",
+              r.name.c_str(), r.iterations, r.seconds, PerSecond(r.items, r.seconds),
+              PerSecond(r.bytes, r.seconds), r.items ? r.seconds * 1e9 / r.items : 0.0,
+              (i + 1 < results_.size()) ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+  }
+
+  void WriteCsv(FILE* file) {
+    fprintf(file, "suite,name,iterations,seconds,items_per_second,bytes_per_second,ns_per_item\n");
+    for (const auto& r : results_) {
+      fprintf(file, "%s,%s,%" PRIu64 ",%.6f,%.1f,%.1f,%.4f\n", suite_.c_str(), r.name.c_str(), r.iterations,
+              r.seconds, PerSecond(r.items, r.seconds), PerSecond(r.bytes, r.seconds),
+              r.items ? r.seconds * 1e9 / r.items : 0.0);
+    }
+  }
+
+  std::string suite_;
+  std::string format_ = "text";
+  std::string output_;
+  std::string filter_;
+  double min_time_ = kDefaultMinTime;
+  FILE* report_file_ = stdout;
+  std::vector<std::pair<std::string, std::string>> context_;
+  std::vector<BenchmarkResult> results_;
+};
+
+} // namespace livox_ros
+
+#endif // LIVOX_ROS_DRIVER_BENCHMARK_REPORT_H_
@@ -0,0 +1,291 @@
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2022 Livox. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+
+// Microbenchmark of the point decode kernels. For every kernel it reports the decode
+// rate and the largest deviation from the reference kernel: the scalar kernel for the
+// cartesian data, the former double precision sin/cos decode for the spherical data.
+// The integer PointCloud2 layouts only report their fill rate.
+//
+// usage: decode_benchmark [packets] [rounds]
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "livox_lidar_def.h"
+#include "comm/comm.h"
+#include "comm/point_decoder.h"
+#include "comm/pointcloud2_layout.h"
+
+using namespace livox_ros;
+
+namespace {
+
+typedef void (*DecodeKernel)(const RawPacket& pkt, uint32_t point_num,
+                             const PointTransform& transform, PointXyzlt* points);
+
+constexpr uint32_t kPointsPerPacket = 96;
+constexpr uint8_t kLineNum = 4;
+
+template <typename RawPoint>
+std::vector<RawPacket> MakePackets(uint32_t packet_num, int32_t range) {
+  std::mt19937 rng(20230101);
+  std::uniform_int_distribution<int32_t> coord(-range, range);
+  std::uniform_int_distribution<int32_t> byte(0, 255);
+
+  std::vector<RawPacket> packets(packet_num);
+  for (uint32_t n = 0; n < packet_num; n++) {
+    RawPacket& pkt = packets[n];
+    pkt.lidar_type = kLivoxLidarType;
+    pkt.handle = 0;
+    pkt.extrinsic_enable = false;
+    pkt.point_num = kPointsPerPacket;
+    pkt.line_num = kLineNum;
+    pkt.time_stamp = 1000000000ULL * n;
+    pkt.point_interval = 5555;
+    pkt.data_length = kPointsPerPacket * sizeof(RawPoint);
+    RawPoint* raw = reinterpret_cast<RawPoint*>(pkt.raw_data);
+    for (uint32_t i = 0; i < kPointsPerPacket; i++) {
+      raw[i].x = coord(rng);
+      raw[i].y = coord(rng);
+      raw[i].z = coord(rng);
+      raw[i].reflectivity = static_cast<uint8_t>(byte(rng));
+      raw[i].tag = static_cast<uint8_t>(byte(rng));
+    }
+  }
+  return packets;
+}
+
+void MakeExtrinsic(ExtParameterDetailed& extrinsic) {
+  const double roll = 1.5 * PI / 180.0;
+  const double pitch = -2.0 * PI / 180.0;
+  const double yaw = 30.0 * PI / 180.0;
+  extrinsic.rotation[0][0] = cos(pitch) * cos(yaw);
+  extrinsic.rotation[0][1] = sin(roll) * sin(pitch) * cos(yaw) - cos(roll) * sin(yaw);
+  extrinsic.rotation[0][2] = cos(roll) * sin(pitch) * cos(yaw) + sin(roll) * sin(yaw);
+  extrinsic.rotation[1][0] = cos(pitch) * sin(yaw);
+  extrinsic.rotation[1][1] = sin(roll) * sin(pitch) * sin(yaw) + cos(roll) * cos(yaw);
+  extrinsic.rotation[1][2] = cos(roll) * sin(pitch) * sin(yaw) - sin(roll) * cos(yaw);
+  extrinsic.rotation[2][0] = -sin(pitch);
+  extrinsic.rotation[2][1] = sin(roll) * cos(pitch);
+  extrinsic.rotation[2][2] = cos(roll) * cos(pitch);
+  extrinsic.trans[0] = 0.12f;
+  extrinsic.trans[1] = -0.045f;
+  extrinsic.trans[2] = 0.3f;
+}
+
+std::vector<RawPacket> MakeSphericalPackets(uint32_t packet_num) {
+  std::mt19937 rng(20230101);
+  std::uniform_int_distribution<uint32_t> depth(0, 200000);
+  std::uniform_int_distribution<uint32_t> theta(0, 18000);
+  std::uniform_int_distribution<uint32_t> phi(0, 35999);
+  std::uniform_int_distribution<int32_t> byte(0, 255);
+
+  std::vector<RawPacket> packets(packet_num);
+  for (uint32_t n = 0; n < packet_num; n++) {
+    RawPacket& pkt = packets[n];
+    pkt.lidar_type = kLivoxLidarType;
+    pkt.handle = 0;
+    pkt.extrinsic_enable = false;
+    pkt.point_num = kPointsPerPacket;
+    pkt.line_num = kLineNum;
+    pkt.time_stamp = 1000000000ULL * n;
+    pkt.point_interval = 5555;
+    pkt.data_length = kPointsPerPacket * sizeof(LivoxLidarSpherPoint);
+    LivoxLidarSpherPoint* raw = reinterpret_cast<LivoxLidarSpherPoint*>(pkt.raw_data);
+    for (uint32_t i = 0; i < kPointsPerPacket; i++) {
+      raw[i].depth = depth(rng);
+      raw[i].theta = static_cast<uint16_t>(theta(rng));
+      raw[i].phi = static_cast<uint16_t>(phi(rng));
+      raw[i].reflectivity = static_cast<uint8_t>(byte(rng));
+      raw[i].tag = static_cast<uint8_t>(byte(rng));
+    }
+  }
+  return packets;
+}
+
+/** the spherical decode as it was done before the trig tables, used as reference */
+void DecodeSphericalPointsTrig(const RawPacket& pkt, uint32_t point_num,
+                               const PointTransform& transform, PointXyzlt* points) {
+  const LivoxLidarSpherPoint* raw = reinterpret_cast<const LivoxLidarSpherPoint*>(pkt.raw_data);
+  for (uint32_t i = 0; i < point_num; i++) {
+    double radius = raw[i].depth;
+    double theta = raw[i].theta / 100.0 / 180 * PI;
+    double phi = raw[i].phi / 100.0 / 180 * PI;
+    double src_x = radius * sin(theta) * cos(phi);
+    double src_y = radius * sin(theta) * sin(phi);
+    double src_z = radius * cos(theta);
+    const float (*r)[3] = transform.rotation;
+    points[i].x = static_cast<float>(src_x * r[0][0] + src_y * r[0][1] + src_z * r[0][2] + transform.trans[0]);
+    points[i].y = static_cast<float>(src_x * r[1][0] + src_y * r[1][1] + src_z * r[1][2] + transform.trans[1]);
+    points[i].z = static_cast<float>(src_x * r[2][0] + src_y * r[2][1] + src_z * r[2][2] + transform.trans[2]);
+    points[i].intensity = raw[i].reflectivity;
+    points[i].line = i % pkt.line_num;
+    points[i].tag = raw[i].tag;
+    points[i].offset_time = pkt.time_stamp + i * pkt.point_interval;
+  }
+}
+
+void DecodeSphericalPointsTable(const RawPacket& pkt, uint32_t point_num,
+                                const PointTransform& transform, PointXyzlt* points) {
+  DecodeSphericalPoints(pkt, transform, points);
+}
+
+double Run(DecodeKernel kernel, const std::vector<RawPacket>& packets,
+           const PointTransform& transform, uint32_t rounds, std::vector<PointXyzlt>& points) {
+  points.resize(packets.size() * kPointsPerPacket);
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t r = 0; r < rounds; r++) {
+    PointXyzlt* out = points.data();
+    for (const auto& pkt : packets) {
+      kernel(pkt, pkt.point_num, transform, out);
+      out += pkt.point_num;
+    }
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return (static_cast<double>(points.size()) * rounds) / elapsed.count();
+}
+
+double MaxDeviation(const std::vector<PointXyzlt>& ref, const std::vector<PointXyzlt>& out,
+                    bool& fields_equal) {
+  double max_dev = 0.0;
+  fields_equal = true;
+  for (size_t i = 0; i < ref.size(); i++) {
+    max_dev = std::fmax(max_dev, std::fabs(ref[i].x - out[i].x));
+    max_dev = std::fmax(max_dev, std::fabs(ref[i].y - out[i].y));
+    max_dev = std::fmax(max_dev, std::fabs(ref[i].z - out[i].z));
+    if (ref[i].intensity != out[i].intensity || ref[i].tag != out[i].tag ||
+        ref[i].line != out[i].line || ref[i].offset_time != out[i].offset_time) {
+      fields_equal = false;
+    }
+  }
+  return max_dev;
+}
+
+template <typename RawPoint>
+bool Bench(const char* name, DecodeKernel scalar, DecodeKernel avx2, int32_t range,
+           float unit_scale, uint32_t packet_num, uint32_t rounds) {
+  std::vector<RawPacket> packets = MakePackets<RawPoint>(packet_num, range);
+  ExtParameterDetailed extrinsic;
+  MakeExtrinsic(extrinsic);
+
+  bool ok = true;
+  for (int with_extrinsic = 0; with_extrinsic < 2; with_extrinsic++) {
+    PointTransform transform;
+    MakePointTransform(with_extrinsic ? &extrinsic : nullptr, unit_scale, transform);
+
+    std::vector<PointXyzlt> ref;
+    std::vector<PointXyzlt> out;
+    double scalar_rate = Run(scalar, packets, transform, rounds, ref);
+    printf("%-12s %-10s %-8s %10.2f Mpts/s\n", name, with_extrinsic ? "extrinsic" : "scale",
+           "scalar", scalar_rate / 1e6);
+    if (!IsAvx2DecodeSupported()) {
+      continue;
+    }
+    double avx2_rate = Run(avx2, packets, transform, rounds, out);
+    bool fields_equal = false;
+    double max_dev = MaxDeviation(ref, out, fields_equal);
+    // both kernels compute in float, allow a few ulp of the largest coordinate
+    double tolerance = range * unit_scale * 4 * 1.2e-7;
+    printf("%-12s %-10s %-8s %10.2f Mpts/s  x%.2f  max deviation %.3g m%s\n", name,
+           with_extrinsic ? "extrinsic" : "scale", "avx2", avx2_rate / 1e6,
+           avx2_rate / scalar_rate, max_dev,
+           (fields_equal && max_dev <= tolerance) ? "" : "  MISMATCH");
+    ok = ok && fields_equal && (max_dev <= tolerance);
+  }
+  return ok;
+}
+
+bool BenchSpherical(uint32_t packet_num, uint32_t rounds) {
+  std::vector<RawPacket> packets = MakeSphericalPackets(packet_num);
+  ExtParameterDetailed extrinsic;
+  MakeExtrinsic(extrinsic);
+  InitSphericalDecodeTable();
+
+  bool ok = true;
+  for (int with_extrinsic = 0; with_extrinsic < 2; with_extrinsic++) {
+    PointTransform transform;
+    MakePointTransform(with_extrinsic ? &extrinsic : nullptr, 0.001f, transform);
+
+    std::vector<PointXyzlt> ref;
+    std::vector<PointXyzlt> out;
+    const char* mode = with_extrinsic ? "extrinsic" : "scale";
+    double trig_rate = Run(DecodeSphericalPointsTrig, packets, transform, rounds, ref);
+    printf("%-12s %-10s %-8s %10.2f Mpts/s\n", "spherical", mode, "trig", trig_rate / 1e6);
+    double table_rate = Run(DecodeSphericalPointsTable, packets, transform, rounds, out);
+    bool fields_equal = false;
+    double max_dev = MaxDeviation(ref, out, fields_equal);
+    // float sin/cos tables against double trig, a few ulp of the 200 m maximum depth
+    double tolerance = 200.0 * 8 * 1.2e-7;
+    printf("%-12s %-10s %-8s %10.2f Mpts/s  x%.2f  max deviation %.3g m%s\n", "spherical",
+           mode, "table", table_rate / 1e6, table_rate / trig_rate, max_dev,
+           (fields_equal && max_dev <= tolerance) ? "" : "  MISMATCH");
+    ok = ok && fields_equal && (max_dev <= tolerance);
+  }
+  return ok;
+}
+
+// Fill rate of the integer layouts from the float decode. Their accuracy is covered by
+// test/test_pointcloud2_layout.cpp.
+void BenchQuantized(uint32_t packet_num, uint32_t rounds) {
+  std::vector<RawPacket> packets = MakePackets<LivoxLidarCartesianHighRawPoint>(packet_num, 200000);
+  PointTransform transform;
+  MakePointTransform(nullptr, 0.001f, transform);
+  std::vector<PointXyzlt> ref;
+  Run(DecodeCartesianHighPointsScalar, packets, transform, 1, ref);
+
+  for (uint8_t type : {kPointCloud2LayoutXyziQ16, kPointCloud2LayoutXyziI32}) {
+    const PointCloud2Layout* layout = GetPointCloud2Layout(type);
+    std::vector<uint8_t> data(ref.size() * layout->point_step);
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t r = 0; r < rounds; r++) {
+      layout->fill(ref.data(), static_cast<uint32_t>(ref.size()), 0, data.data());
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    double rate = (static_cast<double>(ref.size()) * rounds) / elapsed.count();
+    printf("%-12s %-10s %-8s %10.2f Mpts/s  %2u B/pt  scale %.3g m\n", "quantize", "scale",
+           layout->name, rate / 1e6, layout->point_step, layout->scale);
+  }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  uint32_t packet_num = (argc > 1) ? static_cast<uint32_t>(atoi(argv[1])) : 2000;
+  uint32_t rounds = (argc > 2) ? static_cast<uint32_t>(atoi(argv[2])) : 200;
+  printf("decode isa: %s, packets: %u, points per packet: %u, rounds: %u\n",
+         GetPointDecodeIsaName(), packet_num, kPointsPerPacket, rounds);
+
+  bool ok = Bench<LivoxLidarCartesianHighRawPoint>("high", DecodeCartesianHighPointsScalar,
+      DecodeCartesianHighPointsAvx2, 200000, 0.001f, packet_num, rounds);
+  ok = Bench<LivoxLidarCartesianLowRawPoint>("low", DecodeCartesianLowPointsScalar,
+      DecodeCartesianLowPointsAvx2, 32000, 0.01f, packet_num, rounds) && ok;
+  ok = BenchSpherical(packet_num, rounds) && ok;
+  BenchQuantized(packet_num, rounds);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,249 @@
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2022 Livox. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+
+// Throughput of the per-packet and per-frame hot paths between the SDK callback and the
+// message builders: LidarPubHandler::PointCloudProcess for every data type, the frame queue
+// (QueuePushAny/QueuePop), CacheIndex::GetIndex and the PointCloud2 payload fill that
+// Lddc::InitPointcloud2Msg runs for every layout. The ROS message builders themselves are
+// measured by lddc_benchmark.
+//
+// usage: hot_path_benchmark [--format=text|json|csv] [--output=path] [--filter=substring]
+//                           [--min-time=seconds]
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "livox_lidar_def.h"
+#include "comm/cache_index.h"
+#include "comm/comm.h"
+#include "comm/ldq.h"
+#include "comm/point_decoder.h"
+#include "comm/pointcloud2_layout.h"
+#include "comm/pub_handler.h"
+
+#include "benchmark_report.h"
+
+using namespace livox_ros;
+
+namespace {
+
+constexpr uint32_t kPointsPerPacket = 96;
+constexpr uint32_t kPacketsPerFrame = 2084;  /**< 100 ms of a 2 Mpts/s load */
+constexpr uint8_t kLineNum = 4;
+
+uint32_t GetRawPointSize(uint8_t data_type) {
+  if (data_type == kLivoxLidarCartesianCoordinateHighData) {
+    return sizeof(LivoxLidarCartesianHighRawPoint);
+  } else if (data_type == kLivoxLidarCartesianCoordinateLowData) {
+    return sizeof(LivoxLidarCartesianLowRawPoint);
+  }
+  return sizeof(LivoxLidarSpherPoint);
+}
+
+/** one frame of random points in the raw format of data_type, within 200 m */
+std::vector<RawPacket> MakeFrame(uint8_t data_type, bool apply_extrinsic) {
+  std::mt19937 rng(20230101);
+  std::uniform_int_distribution<int32_t> mm(-200000, 200000);
+  std::uniform_int_distribution<int32_t> cm(-20000, 20000);
+  std::uniform_int_distribution<uint32_t> depth(0, 200000);
+  std::uniform_int_distribution<uint32_t> theta(0, 18000);
+  std::uniform_int_distribution<uint32_t> phi(0, 35999);
+  std::uniform_int_distribution<uint32_t> byte(0, 255);
+
+  std::vector<RawPacket> packets(kPacketsPerFrame);
+  for (uint32_t n = 0; n < kPacketsPerFrame; n++) {
+    RawPacket& pkt = packets[n];
+    pkt.lidar_type = kLivoxLidarType;
+    pkt.handle = 0;
+    // extrinsic_enable means the lidar applied it, the driver then only scales to meter
+    pkt.extrinsic_enable = !apply_extrinsic;
+    pkt.data_type = data_type;
+    pkt.point_num = kPointsPerPacket;
+    pkt.line_num = kLineNum;
+    pkt.time_stamp = 1000000000ULL + 48000ULL * n;
+    pkt.point_interval = 500;
+    pkt.data_length = kPointsPerPacket * GetRawPointSize(data_type);
+    for (uint32_t i = 0; i < kPointsPerPacket; i++) {
+      if (data_type == kLivoxLidarCartesianCoordinateHighData) {
+        LivoxLidarCartesianHighRawPoint* raw = reinterpret_cast<LivoxLidarCartesianHighRawPoint*>(pkt.raw_data);
+        raw[i] = {mm(rng), mm(rng), mm(rng), static_cast<uint8_t>(byte(rng)), 0};
+      } else if (data_type == kLivoxLidarCartesianCoordinateLowData) {
+        LivoxLidarCartesianLowRawPoint* raw = reinterpret_cast<LivoxLidarCartesianLowRawPoint*>(pkt.raw_data);
+        raw[i] = {static_cast<int16_t>(cm(rng)), static_cast<int16_t>(cm(rng)),
+                  static_cast<int16_t>(cm(rng)), static_cast<uint8_t>(byte(rng)), 0};
+      } else {
+        LivoxLidarSpherPoint* raw = reinterpret_cast<LivoxLidarSpherPoint*>(pkt.raw_data);
+        raw[i] = {depth(rng), static_cast<uint16_t>(theta(rng)), static_cast<uint16_t>(phi(rng)),
+                  static_cast<uint8_t>(byte(rng)), 0};
+      }
+    }
+  }
+  return packets;
+}
+
+void BenchDecode(BenchmarkReport& report) {
+  const struct {
+    uint8_t data_type;
+    const char* name;
+  } types[] = {
+    {kLivoxLidarCartesianCoordinateHighData, "high"},
+    {kLivoxLidarCartesianCoordinateLowData, "low"},
+    {kLivoxLidarSphericalCoordinateData, "spherical"},
+  };
+  InitSphericalDecodeTable();
+
+  for (const auto& type : types) {
+    for (int apply_extrinsic = 0; apply_extrinsic < 2; apply_extrinsic++) {
+      for (int fused = 0; fused < 2; fused++) {
+        std::string name = std::string("decode/") + type.name + (apply_extrinsic ? "/extrinsic" : "/scale") +
+                           (fused ? "/pointcloud2" : "/xyzlt");
+        if (!report.Selected(name)) {
+          continue;
+        }
+        std::vector<RawPacket> packets = MakeFrame(type.data_type, apply_extrinsic != 0);
+
+        LidarPubHandler handler;
+        LidarExtParameter param;
+        param.handle = 0;
+        param.lidar_type = kLivoxLidarType;
+        param.param = {1.5f, -2.0f, 30.0f, 120, -45, 300};
+        handler.SetLidarsExtParam(param);
+        handler.SetFusedPointCloud2(fused != 0);
+        handler.SetPointsPerFrame(kPacketsPerFrame * kPointsPerPacket);
+
+        // one call decodes a frame and swaps it out, as PubHandler does at every publish
+        std::vector<uint8_t> frame;
+        report.Run(name, kPacketsPerFrame * kPointsPerPacket,
+                   kPacketsPerFrame * static_cast<uint64_t>(packets[0].data_length), [&]() {
+          for (auto& pkt : packets) {
+            handler.PointCloudProcess(pkt);
+          }
+          handler.GetLidarPointClouds(frame);
+        });
+      }
+    }
+  }
+}
+
+void BenchQueue(BenchmarkReport& report) {
+  for (uint32_t points_num : {1000u, 20000u, 200000u}) {
+    std::string name = "ldq/push_pop/" + std::to_string(points_num);
+    if (!report.Selected(name)) {
+      continue;
+    }
+    LidarDataQueue queue;
+    InitQueue(&queue, 16);
+
+    std::vector<uint8_t> buffer(points_num * kPointRecordSize, 1);
+    StoragePacket pkg;
+    PointPacket lidar_point;
+    lidar_point.lidar_type = kLivoxLidarType;
+    lidar_point.handle = 0;
+    // one item is one frame, the queue swaps the buffer through so the cost should not grow
+    // with points_num
+    report.Run(name, 1, 0, [&]() {
+      if (buffer.size() != points_num * kPointRecordSize) {
+        buffer.resize(points_num * kPointRecordSize);
+      }
+      lidar_point.points_num = points_num;
+      lidar_point.points = reinterpret_cast<PointXyzlt*>(buffer.data());
+      lidar_point.buffer = &buffer;
+      QueuePushAny(&queue, reinterpret_cast<uint8_t*>(&lidar_point), 0);
+      QueuePop(&queue, &pkg);
+      buffer.swap(pkg.points);
+    });
+    DeInitQueue(&queue);
+  }
+}
+
+void BenchCacheIndex(BenchmarkReport& report) {
+  for (uint32_t lidar_num : {1u, 8u, 32u}) {
+    std::string name = "cache_index/get_index/" + std::to_string(lidar_num);
+    if (!report.Selected(name)) {
+      continue;
+    }
+    CacheIndex cache_index;
+    std::vector<uint32_t> handles;
+    for (uint32_t i = 0; i < lidar_num; i++) {
+      uint32_t handle = IpStringToNum("192.168.1." + std::to_string(100 + i));
+      uint8_t index = 0;
+      cache_index.GetFreeIndex(kLivoxLidarType, handle, index);
+      handles.push_back(handle);
+    }
+
+    const uint32_t kLookups = 4096;
+    volatile uint8_t sink = 0;
+    report.Run(name, kLookups, 0, [&]() {
+      uint8_t index = 0;
+      for (uint32_t i = 0; i < kLookups; i++) {
+        cache_index.GetIndex(kLivoxLidarType, handles[i % lidar_num], index);
+        sink = sink + index;
+      }
+    });
+  }
+}
+
+void BenchPointCloud2Fill(BenchmarkReport& report) {
+  std::vector<RawPacket> packets = MakeFrame(kLivoxLidarCartesianCoordinateHighData, false);
+  LidarPubHandler handler;
+  handler.SetPointsPerFrame(kPacketsPerFrame * kPointsPerPacket);
+  for (auto& pkt : packets) {
+    handler.PointCloudProcess(pkt);
+  }
+  std::vector<uint8_t> frame;
+  uint64_t base_time = handler.GetLidarPointClouds(frame);
+  const PointXyzlt* points = reinterpret_cast<const PointXyzlt*>(frame.data());
+  const uint32_t points_num = static_cast<uint32_t>(frame.size() / kPointRecordSize);
+
+  for (uint8_t type = 0; type < kPointCloud2LayoutUndef; type++) {
+    const PointCloud2Layout* layout = GetPointCloud2Layout(type);
+    std::vector<uint8_t> data(points_num * layout->point_step);
+    report.Run(std::string("pointcloud2_fill/") + layout->name, points_num,
+               points_num * static_cast<uint64_t>(layout->point_step), [&]() {
+      layout->fill(points, points_num, base_time, data.data());
+    });
+  }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  BenchmarkReport report("hot_path_benchmark");
+  if (!report.ParseArgs(argc, argv)) {
+    return 1;
+  }
+  report.AddContext("decode_isa", GetPointDecodeIsaName());
+  report.AddContext("points_per_packet", std::to_string(kPointsPerPacket));
+  report.AddContext("packets_per_frame", std::to_string(kPacketsPerFrame));
+
+  BenchDecode(report);
+  BenchQueue(report);
+  BenchCacheIndex(report);
+  BenchPointCloud2Fill(report);
+  return report.Finish() ? 0 : 1;
+}
@@ -0,0 +1,115 @@
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2022 Livox. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+
+// Throughput of the ROS2 message builders, Lddc::InitPointcloud2Msg for every PointCloud2
+// layout and Lddc::FillPointsToCustomMsg, on a reused message as the driver runs them.
+// Publishing is not measured, it depends on the RMW and the subscribers.
+//
+// usage: lddc_benchmark [--format=text|json|csv] [--output=path] [--filter=substring]
+//                       [--min-time=seconds]
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "lddc.h"
+#include "comm/comm.h"
+#include "comm/pointcloud2_layout.h"
+
+#include "benchmark_report.h"
+
+namespace livox_ros {
+
+constexpr uint32_t kBenchmarkPointsNum = 200064;  /**< 100 ms of a 2 Mpts/s load */
+
+class LddcBenchmark {
+ public:
+  LddcBenchmark() {
+    std::mt19937 rng(20230101);
+    std::uniform_real_distribution<float> coord(-200.0f, 200.0f);
+    std::uniform_real_distribution<float> intensity(0.0f, 255.0f);
+
+    pkg_.lidar_type = kLivoxLidarType;
+    pkg_.handle = 0;
+    pkg_.base_time = 1000000000ULL;
+    pkg_.points_num = kBenchmarkPointsNum;
+    pkg_.points.resize(kBenchmarkPointsNum * kPointRecordSize);
+    PointXyzlt* points = reinterpret_cast<PointXyzlt*>(pkg_.points.data());
+    for (uint32_t i = 0; i < kBenchmarkPointsNum; i++) {
+      points[i].x = coord(rng);
+      points[i].y = coord(rng);
+      points[i].z = coord(rng);
+      points[i].intensity = intensity(rng);
+      points[i].tag = 0;
+      points[i].line = static_cast<uint8_t>(i % 4);
+      points[i].offset_time = pkg_.base_time + 500ULL * i;
+    }
+  }
+
+  void Run(BenchmarkReport& report) {
+    std::string frame_id = "livox_frame";
+    for (uint8_t type = 0; type < kPointCloud2LayoutUndef; type++) {
+      const PointCloud2Layout* layout = GetPointCloud2Layout(type);
+      std::string name = std::string("init_pointcloud2_msg/") + layout->name;
+      if (!report.Selected(name)) {
+        continue;
+      }
+      // custom msg as the transfer format keeps the PointCloud2 build off the fused path,
+      // which only swaps the frame buffer in
+      Lddc lddc(kLivoxCustomMsg, 0, kSourceRawLidar, kOutputToRos, 10.0, frame_id);
+      lddc.SetPointCloud2Layout(type);
+      PointCloud2 cloud;
+      report.Run(name, kBenchmarkPointsNum, kBenchmarkPointsNum * static_cast<uint64_t>(layout->point_step),
+                 [&]() {
+        uint64_t timestamp = 0;
+        lddc.InitPointcloud2Msg(pkg_, cloud, timestamp);
+      });
+    }
+
+    Lddc lddc(kLivoxCustomMsg, 0, kSourceRawLidar, kOutputToRos, 10.0, frame_id);
+    CustomMsg livox_msg;
+    report.Run("fill_points_to_custom_msg", kBenchmarkPointsNum,
+               kBenchmarkPointsNum * static_cast<uint64_t>(sizeof(CustomPoint)), [&]() {
+      lddc.FillPointsToCustomMsg(livox_msg, pkg_);
+    });
+  }
+
+ private:
+  StoragePacket pkg_;
+};
+
+} // namespace livox_ros
+
+int main(int argc, char** argv) {
+  livox_ros::BenchmarkReport report("lddc_benchmark");
+  if (!report.ParseArgs(argc, argv)) {
+    return 1;
+  }
+  report.AddContext("points_per_frame", std::to_string(livox_ros::kBenchmarkPointsNum));
+
+  livox_ros::LddcBenchmark benchmark;
+  benchmark.Run(report);
+  return report.Finish() ? 0 : 1;
+}
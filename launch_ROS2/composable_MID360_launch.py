@@ -0,0 +1,77 @@
+import os
+from launch import LaunchDescription
+from launch.actions import DeclareLaunchArgument
+from launch.conditions import IfCondition
+from launch.substitutions import LaunchConfiguration, PythonExpression
+from launch_ros.actions import ComposableNodeContainer, LoadComposableNodes
+from launch_ros.descriptions import ComposableNode
+
+################### user configure parameters for ros2 start ###################
+xfer_format   = 0    # 0-Pointcloud2(PointXYZRTL), 1-customized pointcloud format
+multi_topic   = 0    # 0-All LiDARs share the same topic, 1-One LiDAR one topic
+data_src      = 0    # 0-lidar, others-Invalid data src
+publish_freq  = 10.0 # freqency of publish, 5.0, 10.0, 20.0, 50.0, etc.
+output_type   = 0
+frame_id      = 'livox_frame'
+lvx_file_path = '/home/livox/livox_test.lvx'
+cmdline_bd_code = 'livox0000000001'
+
+cur_path = os.path.split(os.path.realpath(__file__))[0] + '/'
+cur_config_path = cur_path + '../config'
+user_config_path = os.path.join(cur_config_path, 'MID360_config.json')
+################### user configure parameters for ros2 end #####################
+
+livox_ros2_params = [
+    {"xfer_format": xfer_format},
+    {"multi_topic": multi_topic},
+    {"data_src": data_src},
+    {"publish_freq": publish_freq},
+    {"output_data_type": output_type},
+    {"frame_id": frame_id},
+    {"lvx_file_path": lvx_file_path},
+    {"user_config_path": user_config_path},
+    {"cmdline_input_bd_code": cmdline_bd_code},
+    {"use_intra_process_comms": 1}
+]
+
+
+# Runs the driver and a point cloud consumer in one process, frames reach the
+# consumer by unique_ptr without being copied or serialized. Pass the consumer
+# component with consumer_package:=<pkg> consumer_plugin:=<namespace::Class>,
+# it has to subscribe to /livox/lidar with intra-process comms enabled as well.
+def generate_launch_description():
+    consumer_package = LaunchConfiguration('consumer_package')
+    consumer_plugin = LaunchConfiguration('consumer_plugin')
+
+    container = ComposableNodeContainer(
+        name='livox_container',
+        namespace='',
+        package='rclcpp_components',
+        executable='component_container',
+        composable_node_descriptions=[
+            ComposableNode(
+                package='livox_ros_driver2',
+                plugin='livox_ros::DriverNode',
+                name='livox_lidar_publisher',
+                parameters=livox_ros2_params,
+                extra_arguments=[{'use_intra_process_comms': True}]),
+        ],
+        output='screen')
+
+    load_consumer = LoadComposableNodes(
+        target_container='livox_container',
+        condition=IfCondition(PythonExpression(["'", consumer_plugin, "' != ''"])),
+        composable_node_descriptions=[
+            ComposableNode(
+                package=consumer_package,
+                plugin=consumer_plugin,
+                name='livox_consumer',
+                extra_arguments=[{'use_intra_process_comms': True}]),
+        ])
+
+    return LaunchDescription([
+        DeclareLaunchArgument('consumer_package', default_value=''),
+        DeclareLaunchArgument('consumer_plugin', default_value=''),
+        container,
+        load_consumer,
+    ])
@@ -30,6 +30,9 @@ namespace livox_ros {
 CacheIndex::CacheIndex() {
   std::array<bool, kMaxLidarCount> index_cache = {0};
   index_cache_.swap(index_cache);
+  for (auto& handle : index_handles_) {
+    handle.store(0, std::memory_order_relaxed);
+  }
 }
 
 int8_t CacheIndex::GetFreeIndex(const uint8_t livox_lidar_type, const uint32_t handle, uint8_t& index) {
@@ -54,6 +57,9 @@ int8_t CacheIndex::GetFreeIndex(const uint8_t livox_lidar_type, const uint32_t h
         index_cache_[i] = 1;
         map_index_[key] = static_cast<uint8_t>(i);
         index = static_cast<uint8_t>(i);
+        if (livox_lidar_type == kLivoxLidarType) {
+          index_handles_[i].store(handle + 1, std::memory_order_release);
+        }
         return 0;
       }
     }
@@ -72,6 +78,15 @@ int8_t CacheIndex::GenerateIndexKey(const uint8_t livox_lidar_type, const uint32
 }
 
 int8_t CacheIndex::GetIndex(const uint8_t livox_lidar_type, const uint32_t handle, uint8_t& index) {
+  if (livox_lidar_type == kLivoxLidarType) {
+    for (uint32_t i = 0; i < kMaxSourceLidar; ++i) {
+      if (index_handles_[i].load(std::memory_order_acquire) == handle + 1) {
+        index = static_cast<uint8_t>(i);
+        return 0;
+      }
+    }
+  }
+
   std::string key;
   int8_t ret = GenerateIndexKey(livox_lidar_type, handle, key);
   if (ret != 0) {
@@ -115,6 +130,7 @@ void CacheIndex::ResetIndex(LidarDevice *lidar) {
     std::lock_guard<std::mutex> lock(index_mutex_);
     map_index_.erase(key);
     index_cache_[index] = 0;
+    index_handles_[index].store(0, std::memory_order_release);
   }
 }
 
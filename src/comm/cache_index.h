@@ -27,6 +27,7 @@
 
 #include <mutex>
 #include <array>
+#include <atomic>
 #include <map>
 #include <string>
 
@@ -47,6 +48,9 @@ class CacheIndex {
   std::mutex index_mutex_;
   std::map<std::string, uint8_t> map_index_; /* key:handle/slot, val:index */
   std::array<bool, kMaxSourceLidar> index_cache_;
+  // handle + 1 of the livox lidar at each index, 0 when free, read without the lock
+  // so the per-sample imu path does not build a string key
+  std::array<std::atomic<uint32_t>, kMaxSourceLidar> index_handles_;
 };
 
 } // namespace livox_ros
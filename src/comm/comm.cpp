@@ -47,6 +47,13 @@ uint32_t CalculatePacketQueueSize(const double publish_freq) {
   return queue_size;
 }
 
+uint32_t CalculatePointsPerFrame(const double publish_freq) {
+  if (publish_freq <= 0.0) {
+    return kMaxPointsPerSecond;
+  }
+  return static_cast<uint32_t>(kMaxPointsPerSecond / publish_freq) + kMaxPointPerEthPacket;
+}
+
 std::string IpNumToString(uint32_t ip_num) {
   struct in_addr ip;
   ip.s_addr = ip_num;
@@ -66,5 +73,9 @@ std::string ReplacePeriodByUnderline(std::string str) {
   return str;
 }
 
+bool ShouldLogCount(uint64_t count) {
+  return (count != 0) && ((count & (count - 1)) == 0);
+}
+
 } // namespace livox_ros
 
@@ -30,7 +30,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include <atomic>
+#include <condition_variable>
 #include <iostream>
+#include <mutex>
 #include <string>
 #include <vector>
 #include <memory>
@@ -42,6 +45,8 @@ namespace livox_ros {
 
 /** Max lidar data source num */
 const uint8_t kMaxSourceLidar = 32;
+static_assert(kMaxSourceLidar <= 32, "ReadyMask holds one bit per lidar index");
+const uint32_t kReadyWaitTimeoutMs = 100;  /**< publish threads recheck exit at least this often */
 
 
 /** Eth packet relative info parama */
@@ -49,6 +54,8 @@ const uint32_t kMaxPointPerEthPacket = 100;
 const uint32_t kMinEthPacketQueueSize = 32;     /**< must be 2^n */
 const uint32_t kMaxEthPacketQueueSize = 131072; /**< must be 2^n */
 const uint32_t kImuEthPacketQueueSize = 256;
+const uint32_t kDefaultRawPacketQueueSize = 4096; /**< must be 2^n */
+const uint32_t kMaxPointsPerSecond = 480000;      /**< upper bound of the supported lidars point rate */
 
 /** Max packet length according to Ethernet MTU */
 const uint32_t KEthPacketMaxLength = 1500;
@@ -76,6 +83,7 @@ const uint32_t kPointXYZRTRSize = 18;
 const double PI = 3.14159265358979323846;
 
 constexpr uint32_t kMaxBufferSize = 0x8000;  // 32k bytes
+constexpr uint32_t kCacheLineSize = 64;
 
 /** Device Line Number **/
 const uint8_t kLineNumberDefault = 1;
@@ -111,11 +119,22 @@ typedef enum {
   kSourceRawLidar = 0, /**< Data from raw lidar. */
   kSourceRawHub = 1,   /**< Data from lidar hub. */
   kSourceLvxFile,      /**< Data from parse lvx file. */
+  kSourcePacketFile,   /**< Data from a packet capture or pcap file. */
+  kSourceSynthetic,    /**< Data from the synthetic packet generator. */
   kSourceUndef,
 } LidarDataSourceType;
 
 typedef enum { kCoordinateCartesian = 0, kCoordinateSpherical } CoordinateType;
 
+/** What the lidar data queue does with a new frame when it is full */
+typedef enum {
+  kQueueDropNewest = 0, /**< Discard the new frame. */
+  kQueueDropOldest = 1, /**< Evict the oldest queued frame. */
+  kQueueBlock = 2,      /**< Wait for the publisher up to a timeout, then discard the new frame. */
+} QueueOverflowPolicy;
+
+const uint32_t kDefaultQueueBlockTimeoutMs = 50;
+
 typedef enum {
   kConfigDataType = 1 << 0,
   kConfigScanPattern = 1 << 1,
@@ -172,6 +191,7 @@ typedef struct {
   uint8_t lidar_type; ////refer to LivoxLidarType
   uint32_t points_num;
   PointXyzlt* points;
+  std::vector<uint8_t>* buffer;  /**< owner of points, swapped into the queue when set */
 } PointPacket;
 
 typedef struct {
@@ -182,12 +202,17 @@ typedef struct {
 
 #pragma pack()
 
+/** Frames carry point records as raw bytes so a PointCloud2 payload can take them over. */
+constexpr uint32_t kPointRecordSize = sizeof(PointXyzlt);
+static_assert(sizeof(PointXyzlt) == sizeof(LivoxPointXyzrtlt),
+              "PointXyzlt and LivoxPointXyzrtlt records must share one layout");
+
 typedef struct {
   LidarProtoType lidar_type;
   uint32_t handle;
   uint64_t base_time;
   uint32_t points_num;
-  std::vector<PointXyzlt> points;
+  std::vector<uint8_t> points;  /**< PointXyzlt records, LivoxPointXyzrtlt when fused */
 } StoragePacket;
 
 typedef struct {
@@ -199,15 +224,27 @@ typedef struct {
   uint8_t line_num;
   uint64_t time_stamp;
   uint64_t point_interval;
-  std::vector<uint8_t> raw_data;
+  uint32_t data_length;
+  uint8_t raw_data[KEthPacketMaxLength];
 } RawPacket;
 
+/**
+ * Single-producer/single-consumer frame queue, the decode thread pushes and the
+ * publish thread pops. wr_idx is released by the producer and rd_idx by the consumer.
+ */
 typedef struct {
-  StoragePacket *storage_packet;
-  volatile uint32_t rd_idx;
-  volatile uint32_t wr_idx;
-  uint32_t mask;
-  uint32_t size; /**< must be power of 2. */
+  StoragePacket *storage_packet {};
+  std::atomic<uint32_t> rd_idx {0};
+  std::atomic<uint32_t> wr_idx {0};
+  uint32_t mask {};
+  uint32_t size {}; /**< must be power of 2. */
+  uint8_t overflow_policy {kQueueDropNewest};
+  uint32_t block_timeout_ms {kDefaultQueueBlockTimeoutMs};
+  std::atomic<uint64_t> dropped {0};    /**< frames discarded on overflow */
+  std::atomic<uint32_t> peak_used {0};  /**< high watermark, for sizing the queue */
+  std::atomic<bool> waiting {false};    /**< producer sleeping in kQueueBlock */
+  std::mutex mutex;                     /**< pop vs eviction in kQueueDropOldest, wakeup in kQueueBlock */
+  std::condition_variable cv;
 } LidarDataQueue;
 
 /*****************************/
@@ -221,7 +258,7 @@ typedef struct {
   int32_t z;   /**< Z translation, unit: mm. */
 } ExtParameter;
 
-typedef float TranslationVector[3]; /**< x, y, z translation, unit: mm. */
+typedef float TranslationVector[3]; /**< x, y, z translation, unit: m. */
 typedef float RotationMatrix[3][3];
 
 typedef struct {
@@ -265,6 +302,7 @@ typedef struct {
   int32_t blind_spot_set;
   int8_t dual_emit_en;
   ExtParameter extrinsic_param;
+  int32_t decode_cpu;               /**< Cpu the decode thread is pinned to, -1 for no pinning. */
   volatile uint32_t set_bits;
   volatile uint32_t get_bits;
 } UserLivoxLidarConfig;
@@ -295,9 +333,12 @@ constexpr uint32_t kDeviceTypeLidarMid70 = 6;
 /* Global function for general use */
 bool IsFilePathValid(const char *path_str);
 uint32_t CalculatePacketQueueSize(const double publish_freq);
+uint32_t CalculatePointsPerFrame(const double publish_freq);
 std::string IpNumToString(uint32_t ip_num);
 uint32_t IpStringToNum(std::string ip_string);
 std::string ReplacePeriodByUnderline(std::string str);
+/** true for counts 1, 2, 4, 8..., so a repeating drop or skip is logged without flooding the console */
+bool ShouldLogCount(uint64_t count);
 
 } // namespace livox_ros
 
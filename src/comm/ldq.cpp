@@ -22,20 +22,32 @@
 // SOFTWARE.
 //
 
+#include <inttypes.h>
 #include <stdio.h>
 #include <string.h>
+#include <chrono>
 
 #include "ldq.h"
 
 namespace livox_ros {
 
 /* for pointcloud queue process */
-bool InitQueue(LidarDataQueue *queue, uint32_t queue_size) {
+bool InitQueue(LidarDataQueue *queue, uint32_t queue_size, uint8_t overflow_policy,
+               uint32_t block_timeout_ms) {
   if (queue == nullptr) {
     // ROS_WARN("RosDriver Queue: Initialization failed - invalid queue.");
     return false;
   }
 
+  // set before the storage exists, the consumer reads the policy unlocked in QueuePop and
+  // only reaches the queue through the wr_idx release of the first push
+  if (overflow_policy > kQueueBlock) {
+    printf("Unknown queue overflow policy:%u, drop the newest frame instead.\n", overflow_policy);
+    overflow_policy = kQueueDropNewest;
+  }
+  queue->overflow_policy = overflow_policy;
+  queue->block_timeout_ms = block_timeout_ms;
+
   if (!IsPowerOf2(queue_size)) {
     queue_size = RoundupPowerOf2(queue_size);
     printf("Init queue, real query size:%u.\n", queue_size);
@@ -52,10 +64,12 @@ bool InitQueue(LidarDataQueue *queue, uint32_t queue_size) {
     return false;
   }
 
-  queue->rd_idx = 0;
-  queue->wr_idx = 0;
+  queue->rd_idx.store(0);
+  queue->wr_idx.store(0);
   queue->size = queue_size;
   queue->mask = queue_size - 1;
+  queue->dropped.store(0);
+  queue->peak_used.store(0);
 
   return true;
 }
@@ -67,11 +81,16 @@ bool DeInitQueue(LidarDataQueue *queue) {
   }
 
   if (queue->storage_packet) {
+    if (queue->dropped.load() != 0) {
+      printf("Deinit queue, dropped frames:%" PRIu64 ", peak used:%u/%u.\n", queue->dropped.load(),
+          queue->peak_used.load(), queue->size);
+    }
     delete[] queue->storage_packet;
+    queue->storage_packet = nullptr;
   }
 
-  queue->rd_idx = 0;
-  queue->wr_idx = 0;
+  queue->rd_idx.store(0);
+  queue->wr_idx.store(0);
   queue->size = 0;
   queue->mask = 0;
 
@@ -79,8 +98,8 @@ bool DeInitQueue(LidarDataQueue *queue) {
 }
 
 void ResetQueue(LidarDataQueue *queue) {
-  queue->rd_idx = 0;
-  queue->wr_idx = 0;
+  queue->rd_idx.store(0);
+  queue->wr_idx.store(0);
 }
 
 bool QueuePrePop(LidarDataQueue *queue, StoragePacket *storage_packet) {
@@ -94,31 +113,58 @@ bool QueuePrePop(LidarDataQueue *queue, StoragePacket *storage_packet) {
     return false;
   }
 
-  uint32_t rd_idx = queue->rd_idx & queue->mask;
+  uint32_t rd_idx = queue->rd_idx.load(std::memory_order_relaxed) & queue->mask;
 
   storage_packet->base_time = queue->storage_packet[rd_idx].base_time;
   storage_packet->points_num = queue->storage_packet[rd_idx].points_num;
-  storage_packet->points.resize(queue->storage_packet[rd_idx].points_num);
+  storage_packet->points.resize(queue->storage_packet[rd_idx].points_num * kPointRecordSize);
 
-  memcpy(storage_packet->points.data(), queue->storage_packet[rd_idx].points.data(), (storage_packet->points_num) * sizeof(PointXyzlt));
+  memcpy(storage_packet->points.data(), queue->storage_packet[rd_idx].points.data(), (storage_packet->points_num) * kPointRecordSize);
   return true;
 }
 
 void QueuePopUpdate(LidarDataQueue *queue) {
-  queue->rd_idx++;
+  queue->rd_idx.store(queue->rd_idx.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+
+  // pairs with the fence in QueueMakeRoom, either the producer sees the free slot or we see it sleeping
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (queue->waiting.load(std::memory_order_relaxed)) {
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    queue->cv.notify_one();
+  }
 }
 
 bool QueuePop(LidarDataQueue *queue, StoragePacket *storage_packet) {
-  if (!QueuePrePop(queue, storage_packet)) {
+  if (queue == nullptr || storage_packet == nullptr) {
+    return false;
+  }
+
+  // the producer may evict the oldest slot in this mode, so reading it and moving rd_idx is one step
+  std::unique_lock<std::mutex> lock(queue->mutex, std::defer_lock);
+  if (queue->overflow_policy == kQueueDropOldest) {
+    lock.lock();
+  }
+
+  if (QueueIsEmpty(queue)) {
     return false;
   }
-  QueuePopUpdate(queue);
+
+  // hand the frame buffer over instead of copying it, the slot keeps the caller's old buffer
+  uint32_t rd_idx = queue->rd_idx.load(std::memory_order_relaxed) & queue->mask;
+  storage_packet->base_time = queue->storage_packet[rd_idx].base_time;
+  storage_packet->points_num = queue->storage_packet[rd_idx].points_num;
+  storage_packet->points.swap(queue->storage_packet[rd_idx].points);
+  if (lock.owns_lock()) {
+    queue->rd_idx.store(queue->rd_idx.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  } else {
+    QueuePopUpdate(queue);
+  }
 
   return true;
 }
 
 uint32_t QueueUsedSize(LidarDataQueue *queue) {
-  return queue->wr_idx - queue->rd_idx;
+  return queue->wr_idx.load(std::memory_order_acquire) - queue->rd_idx.load(std::memory_order_acquire);
 }
 
 uint32_t QueueUnusedSize(LidarDataQueue *queue) {
@@ -126,24 +172,77 @@ uint32_t QueueUnusedSize(LidarDataQueue *queue) {
 }
 
 bool QueueIsFull(LidarDataQueue *queue) {
-  return ((queue->wr_idx - queue->rd_idx) > queue->mask);
+  return (QueueUsedSize(queue) > queue->mask);
 }
 
 bool QueueIsEmpty(LidarDataQueue *queue) {
-  return (queue->rd_idx == queue->wr_idx);
+  return (queue->rd_idx.load(std::memory_order_acquire) == queue->wr_idx.load(std::memory_order_acquire));
+}
+
+uint64_t QueueDropCount(LidarDataQueue *queue) {
+  return queue->dropped.load(std::memory_order_relaxed);
+}
+
+uint32_t QueuePeakUsedSize(LidarDataQueue *queue) {
+  return queue->peak_used.load(std::memory_order_relaxed);
+}
+
+bool QueueMakeRoom(LidarDataQueue *queue) {
+  if (!QueueIsFull(queue)) {
+    return true;
+  }
+
+  if (queue->overflow_policy == kQueueDropOldest) {
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    if (QueueIsFull(queue)) {
+      queue->rd_idx.store(queue->rd_idx.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+      queue->dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+    return true;
+  }
+
+  if (queue->overflow_policy == kQueueBlock) {
+    std::unique_lock<std::mutex> lock(queue->mutex);
+    queue->waiting.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    queue->cv.wait_for(lock, std::chrono::milliseconds(queue->block_timeout_ms),
+        [queue]() { return !QueueIsFull(queue); });
+    queue->waiting.store(false, std::memory_order_relaxed);
+    if (!QueueIsFull(queue)) {
+      return true;
+    }
+  }
+
+  queue->dropped.fetch_add(1, std::memory_order_relaxed);
+  return false;
 }
 
 uint32_t QueuePushAny(LidarDataQueue *queue, uint8_t *data, const uint64_t base_time) {
-  uint32_t wr_idx = queue->wr_idx & queue->mask;
+  uint32_t wr = queue->wr_idx.load(std::memory_order_relaxed);
+  uint32_t wr_idx = wr & queue->mask;
   PointPacket* lidar_point_data = reinterpret_cast<PointPacket*>(data);
   queue->storage_packet[wr_idx].base_time = base_time;
   queue->storage_packet[wr_idx].points_num = lidar_point_data->points_num;
 
-  queue->storage_packet[wr_idx].points.clear();
-  queue->storage_packet[wr_idx].points.resize(lidar_point_data->points_num);
-  memcpy(queue->storage_packet[wr_idx].points.data(), lidar_point_data->points, sizeof(PointXyzlt) * (lidar_point_data->points_num));
+  if (lidar_point_data->buffer != nullptr &&
+      lidar_point_data->buffer->size() == lidar_point_data->points_num * kPointRecordSize) {
+    // take the producer's buffer, it gets the slot's previous one back for reuse
+    queue->storage_packet[wr_idx].points.swap(*lidar_point_data->buffer);
+    lidar_point_data->buffer->clear();
+    lidar_point_data->points = nullptr;
+  } else {
+    queue->storage_packet[wr_idx].points.clear();
+    queue->storage_packet[wr_idx].points.resize(lidar_point_data->points_num * kPointRecordSize);
+    memcpy(queue->storage_packet[wr_idx].points.data(), lidar_point_data->points, kPointRecordSize * (lidar_point_data->points_num));
+  }
+
+  // publish the slot contents before the consumer can see the new index
+  queue->wr_idx.store(wr + 1, std::memory_order_release);
 
-  queue->wr_idx++;
+  uint32_t used = QueueUsedSize(queue);
+  if (used > queue->peak_used.load(std::memory_order_relaxed)) {
+    queue->peak_used.store(used, std::memory_order_relaxed);
+  }
   return 1;
 }
 
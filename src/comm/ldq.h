@@ -49,7 +49,8 @@ inline static uint32_t RoundupPowerOf2(uint32_t size) {
 }
 
 /** queue operate function */
-bool InitQueue(LidarDataQueue *queue, uint32_t queue_size);
+bool InitQueue(LidarDataQueue *queue, uint32_t queue_size, uint8_t overflow_policy = kQueueDropNewest,
+               uint32_t block_timeout_ms = kDefaultQueueBlockTimeoutMs);
 bool DeInitQueue(LidarDataQueue *queue);
 void ResetQueue(LidarDataQueue *queue);
 bool QueuePrePop(LidarDataQueue *queue, StoragePacket *storage_packet);
@@ -59,6 +60,10 @@ uint32_t QueueUsedSize(LidarDataQueue *queue);
 uint32_t QueueUnusedSize(LidarDataQueue *queue);
 bool QueueIsFull(LidarDataQueue *queue);
 bool QueueIsEmpty(LidarDataQueue *queue);
+uint64_t QueueDropCount(LidarDataQueue *queue);
+uint32_t QueuePeakUsedSize(LidarDataQueue *queue);
+/** apply the overflow policy when full, returns false if the new frame has to be dropped */
+bool QueueMakeRoom(LidarDataQueue *queue);
 uint32_t QueuePushAny(LidarDataQueue *queue, uint8_t *data, const uint64_t base_time);
 
 }  // namespace livox_ros
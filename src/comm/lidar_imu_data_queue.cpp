@@ -26,45 +26,35 @@
 
 namespace livox_ros {
 
-void LidarImuDataQueue::Push(ImuData* imu_data) {
-  ImuData data;
-  data.lidar_type = imu_data->lidar_type;
-  data.handle = imu_data->handle;
-  data.time_stamp = imu_data->time_stamp;
+static_assert((kImuDataQueueSize & (kImuDataQueueSize - 1)) == 0, "imu queue size must be 2^n");
 
-  data.gyro_x = imu_data->gyro_x;
-  data.gyro_y = imu_data->gyro_y;
-  data.gyro_z = imu_data->gyro_z;
-
-  data.acc_x = imu_data->acc_x;
-  data.acc_y = imu_data->acc_y;
-  data.acc_z = imu_data->acc_z;
-
-  std::lock_guard<std::mutex> lock(mutex_);
-  imu_data_queue_.push_back(std::move(data));
+bool LidarImuDataQueue::Push(ImuData* imu_data) {
+  uint32_t wr_idx = wr_idx_.load(std::memory_order_relaxed);
+  if ((wr_idx - rd_idx_.load(std::memory_order_acquire)) >= kImuDataQueueSize) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  slots_[wr_idx & (kImuDataQueueSize - 1)] = *imu_data;
+  wr_idx_.store(wr_idx + 1, std::memory_order_release);
+  return true;
 }
 
 bool LidarImuDataQueue::Pop(ImuData& imu_data) {
-  std::lock_guard<std::mutex> lock(mutex_);
-  if (imu_data_queue_.empty()) {
+  uint32_t rd_idx = rd_idx_.load(std::memory_order_relaxed);
+  if (rd_idx == wr_idx_.load(std::memory_order_acquire)) {
     return false;
   }
-  imu_data = imu_data_queue_.front();
-  imu_data_queue_.pop_front();
+  imu_data = slots_[rd_idx & (kImuDataQueueSize - 1)];
+  rd_idx_.store(rd_idx + 1, std::memory_order_release);
   return true;
 }
 
 bool LidarImuDataQueue::Empty() {
-  std::lock_guard<std::mutex> lock(mutex_);
-  return imu_data_queue_.empty();
+  return rd_idx_.load(std::memory_order_acquire) == wr_idx_.load(std::memory_order_acquire);
 }
 
 void LidarImuDataQueue::Clear() {
-  std::list<ImuData> tmp_imu_data_queue;
-  {
-    std::lock_guard<std::mutex> lock(mutex_);
-    imu_data_queue_.swap(tmp_imu_data_queue);
-  }
+  rd_idx_.store(wr_idx_.load(std::memory_order_acquire), std::memory_order_release);
 }
 
-} // namespace livox_ros
\ No newline at end of file
+} // namespace livox_ros
@@ -25,8 +25,7 @@
 #ifndef LIVOX_ROS_DRIVER_LIDAR_IMU_DATA_QUEUE_H_
 #define LIVOX_ROS_DRIVER_LIDAR_IMU_DATA_QUEUE_H_
 
-#include <list>
-#include <mutex>
+#include <atomic>
 #include <cstdint>
 
 namespace livox_ros {
@@ -57,18 +56,31 @@ typedef struct {
   float acc_x;         /**< Accelerometer X axis, Unit:g */
   float acc_y;         /**< Accelerometer Y axis, Unit:g */
   float acc_z;         /**< Accelerometer Z axis, Unit:g */
+  uint64_t recv_time;  /**< Host steady clock ns when the sample left the SDK callback */
 } ImuData;
 
+/** 2^n, 1.28 s of samples at the 200 Hz imu rate */
+constexpr uint32_t kImuDataQueueSize = 256;
+
+/**
+ * Preallocated single-producer/single-consumer ring of ImuData, the SDK thread pushes
+ * and the imu publish thread pops. A full ring drops the new sample and counts it.
+ */
 class LidarImuDataQueue {
  public:
-  void Push(ImuData* imu_data);
+  bool Push(ImuData* imu_data);
   bool Pop(ImuData& imu_data);
   bool Empty();
+  /** consumer side, or while neither side is running */
   void Clear();
+  uint64_t GetDropCount() { return dropped_.load(std::memory_order_relaxed); }
 
  private:
-  std::mutex mutex_;
-  std::list<ImuData> imu_data_queue_;
+  ImuData slots_[kImuDataQueueSize];
+  // rd/wr indexes live on separate cache lines so the two threads do not share them
+  alignas(64) std::atomic<uint32_t> rd_idx_{0};
+  alignas(64) std::atomic<uint32_t> wr_idx_{0};
+  std::atomic<uint64_t> dropped_{0};
 };
 
 } // namespace
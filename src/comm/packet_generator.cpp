@@ -0,0 +1,269 @@
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2022 Livox. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+
+#include "packet_generator.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <thread>
+
+#include "comm/comm.h"
+#include "comm/lidar_imu_data_queue.h"
+
+namespace livox_ros {
+
+namespace {
+
+// LivoxLidarEthernetPacket without its one byte data placeholder
+const uint32_t kEthPacketHeaderSize = sizeof(LivoxLidarEthernetPacket) - 1;
+const uint32_t kMaxSyntheticPointRate = 10000000;
+// packets due within this are sent at once instead of sleeping for each of them
+const auto kSleepSlack = std::chrono::microseconds(100);
+
+typedef struct {
+  float azimuth_min;    /**< degree */
+  float azimuth_range;
+  float elevation_min;
+  float elevation_range;
+} FieldOfView;
+
+const FieldOfView kMid360Fov = {0.0f, 360.0f, -7.0f, 59.0f};
+const FieldOfView kHapFov = {-60.0f, 120.0f, -12.5f, 25.0f};
+
+uint32_t GetRawPointSize(uint8_t data_type) {
+  if (data_type == kLivoxLidarCartesianCoordinateHighData) {
+    return sizeof(LivoxLidarCartesianHighRawPoint);
+  } else if (data_type == kLivoxLidarCartesianCoordinateLowData) {
+    return sizeof(LivoxLidarCartesianLowRawPoint);
+  } else if (data_type == kLivoxLidarSphericalCoordinateData) {
+    return sizeof(LivoxLidarSpherPoint);
+  }
+  return 0;
+}
+
+inline float Fraction(float value) { return value - std::floor(value); }
+
+uint64_t NowNs(std::chrono::system_clock::time_point time) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+} // namespace
+
+bool PacketGenerator::Init(const PacketGeneratorConfig& config) {
+  config_ = config;
+  config_.lidar_num = std::min<uint32_t>(std::max<uint32_t>(config_.lidar_num, 1), kMaxSourceLidar);
+  if (GetRawPointSize(config_.data_type) == 0) {
+    printf("Invalid synthetic data type:%u, use cartesian high.\n", config_.data_type);
+    config_.data_type = kLivoxLidarCartesianCoordinateHighData;
+  }
+  if (config_.dev_type != 0 && config_.dev_type != LivoxLidarDeviceType::kLivoxLidarTypeMid360 &&
+      config_.dev_type != LivoxLidarDeviceType::kLivoxLidarTypeIndustrialHAP) {
+    printf("Invalid synthetic device type:%u, use mid360.\n", config_.dev_type);
+    config_.dev_type = LivoxLidarDeviceType::kLivoxLidarTypeMid360;
+  }
+  if (config_.point_rate != 0) {
+    config_.point_rate = std::min(std::max(config_.point_rate, kGeneratorPointsPerPacket),
+                                  kMaxSyntheticPointRate);
+  }
+  config_.imu_rate = std::min<uint32_t>(config_.imu_rate, 1000);
+  packet_size_ = kEthPacketHeaderSize + kGeneratorPointsPerPacket * GetRawPointSize(config_.data_type);
+
+  lidars_.clear();
+  lidars_.resize(config_.lidar_num);
+  for (uint32_t i = 0; i < config_.lidar_num; ++i) {
+    VirtualLidar& lidar = lidars_[i];
+    lidar.handle = IpStringToNum("192.168.100." + std::to_string(i + 1));
+    if (config_.dev_type != 0) {
+      lidar.dev_type = config_.dev_type;
+    } else {
+      lidar.dev_type = (i % 2) ? LivoxLidarDeviceType::kLivoxLidarTypeIndustrialHAP :
+                                 LivoxLidarDeviceType::kLivoxLidarTypeMid360;
+    }
+    uint32_t point_rate = config_.point_rate;
+    if (point_rate == 0) {
+      point_rate = (lidar.dev_type == LivoxLidarDeviceType::kLivoxLidarTypeIndustrialHAP) ?
+                   kHapPointRate : kMid360PointRate;
+    }
+    lidar.point_period = static_cast<uint64_t>(kGeneratorPointsPerPacket) * kNsPerSecond / point_rate;
+    lidar.imu_period = config_.imu_rate ? kNsPerSecond / config_.imu_rate : 0;
+    lidar.packet_index = i % kGeneratorPacketNum;
+    BuildPackets(lidar);
+  }
+
+  uint64_t total_rate = 0;
+  for (auto& lidar : lidars_) {
+    total_rate += static_cast<uint64_t>(kGeneratorPointsPerPacket) * kNsPerSecond / lidar.point_period;
+  }
+  printf("Synthetic lidars:%u, device type:%u, data type:%u, imu:%uHz, time sync:%d, "
+         "%.2f Mpts/s in total.\n", config_.lidar_num, config_.dev_type, config_.data_type,
+         config_.imu_rate, config_.time_sync, total_rate / 1e6);
+  return true;
+}
+
+void PacketGenerator::BuildPackets(VirtualLidar& lidar) {
+  const FieldOfView& fov =
+      (lidar.dev_type == LivoxLidarDeviceType::kLivoxLidarTypeIndustrialHAP) ? kHapFov : kMid360Fov;
+  const uint32_t point_size = GetRawPointSize(config_.data_type);
+  const uint32_t total_points = kGeneratorPacketNum * kGeneratorPointsPerPacket;
+  const float kDegToRad = static_cast<float>(M_PI / 180.0);
+
+  LivoxLidarEthernetPacket header;
+  memset(&header, 0, sizeof(header));
+  header.length = static_cast<uint16_t>(packet_size_);
+  header.time_interval = static_cast<uint16_t>(std::min<uint64_t>(lidar.point_period / 100, UINT16_MAX));
+  header.dot_num = kGeneratorPointsPerPacket;
+  header.data_type = config_.data_type;
+  header.time_type = config_.time_sync ? kTimestampTypeGptpOrPtp : kTimestampTypeNoSync;
+
+  // a scan that sweeps the elevation over the ring and scatters azimuth and range
+  lidar.packets.assign(kGeneratorPacketNum * packet_size_, 0);
+  for (uint32_t p = 0; p < kGeneratorPacketNum; ++p) {
+    uint8_t* packet = lidar.packets.data() + p * packet_size_;
+    memcpy(packet, &header, kEthPacketHeaderSize);
+    uint8_t* points = packet + kEthPacketHeaderSize;
+    for (uint32_t k = 0; k < kGeneratorPointsPerPacket; ++k) {
+      uint32_t j = p * kGeneratorPointsPerPacket + k;
+      float azimuth = fov.azimuth_min + fov.azimuth_range * Fraction(j * 0.618034f);
+      float elevation = fov.elevation_min + fov.elevation_range * (j + 0.5f) / total_points;
+      float range = 2.0f + 48.0f * Fraction(j * 0.754878f);  // m
+      float x = range * std::cos(elevation * kDegToRad) * std::cos(azimuth * kDegToRad);
+      float y = range * std::cos(elevation * kDegToRad) * std::sin(azimuth * kDegToRad);
+      float z = range * std::sin(elevation * kDegToRad);
+      uint8_t reflectivity = static_cast<uint8_t>(j);
+
+      if (config_.data_type == kLivoxLidarCartesianCoordinateHighData) {
+        LivoxLidarCartesianHighRawPoint point = {static_cast<int32_t>(x * 1000.0f),
+            static_cast<int32_t>(y * 1000.0f), static_cast<int32_t>(z * 1000.0f), reflectivity, 0};
+        memcpy(points + k * point_size, &point, point_size);
+      } else if (config_.data_type == kLivoxLidarCartesianCoordinateLowData) {
+        LivoxLidarCartesianLowRawPoint point = {static_cast<int16_t>(x * 100.0f),
+            static_cast<int16_t>(y * 100.0f), static_cast<int16_t>(z * 100.0f), reflectivity, 0};
+        memcpy(points + k * point_size, &point, point_size);
+      } else {
+        // theta from the z axis, phi around it, both in 0.01 degree
+        float phi = (azimuth < 0.0f) ? azimuth + 360.0f : azimuth;
+        LivoxLidarSpherPoint point = {static_cast<uint32_t>(range * 1000.0f),
+            static_cast<uint16_t>((90.0f - elevation) * 100.0f), static_cast<uint16_t>(phi * 100.0f),
+            reflectivity, 0};
+        memcpy(points + k * point_size, &point, point_size);
+      }
+    }
+  }
+
+  RawImuPoint imu = {0.01f, -0.02f, 0.005f, 0.0f, 0.0f, 1.0f};
+  lidar.imu_packet.assign(kEthPacketHeaderSize + sizeof(imu), 0);
+  header.length = static_cast<uint16_t>(lidar.imu_packet.size());
+  header.time_interval = 0;
+  header.dot_num = 1;
+  header.data_type = kLivoxLidarImuData;
+  memcpy(lidar.imu_packet.data(), &header, kEthPacketHeaderSize);
+  memcpy(lidar.imu_packet.data() + kEthPacketHeaderSize, &imu, sizeof(imu));
+}
+
+std::vector<uint32_t> PacketGenerator::GetHandles() {
+  std::vector<uint32_t> handles;
+  for (const auto& lidar : lidars_) {
+    handles.push_back(lidar.handle);
+  }
+  return handles;
+}
+
+uint64_t PacketGenerator::Run(const PacketCallback& cb, const std::atomic<bool>* quit) {
+  packet_count_ = 0;
+  point_count_ = 0;
+  imu_count_ = 0;
+  max_lag_ = 0;
+  if (lidars_.empty() || !cb) {
+    return 0;
+  }
+
+  // stagger the lidars so their packets do not all fall on the same instant
+  const uint32_t lidar_num = static_cast<uint32_t>(lidars_.size());
+  for (uint32_t i = 0; i < lidar_num; ++i) {
+    lidars_[i].next_point_time = lidars_[i].point_period * i / lidar_num;
+    lidars_[i].next_imu_time = lidars_[i].imu_period * i / lidar_num;
+    lidars_[i].udp_cnt = 0;
+  }
+  const uint64_t end_time = (config_.duration > 0.0) ?
+      static_cast<uint64_t>(config_.duration * kNsPerSecond) : UINT64_MAX;
+  base_time_ = config_.time_sync ? NowNs(std::chrono::system_clock::now()) : 0;
+  auto start = std::chrono::steady_clock::now();
+
+  while (quit == nullptr || !quit->load(std::memory_order_relaxed)) {
+    VirtualLidar* next = nullptr;
+    uint64_t time = UINT64_MAX;
+    bool imu = false;
+    for (auto& lidar : lidars_) {
+      if (lidar.next_point_time < time) {
+        next = &lidar;
+        time = lidar.next_point_time;
+        imu = false;
+      }
+      if (lidar.imu_period != 0 && lidar.next_imu_time < time) {
+        next = &lidar;
+        time = lidar.next_imu_time;
+        imu = true;
+      }
+    }
+    if (time >= end_time) {
+      break;
+    }
+
+    auto due = start + std::chrono::nanoseconds(time);
+    auto now = std::chrono::steady_clock::now();
+    if (due > now + kSleepSlack) {
+      std::this_thread::sleep_until(due);
+    } else if (now > due) {
+      max_lag_ = std::max<uint64_t>(max_lag_, std::chrono::duration_cast<std::chrono::nanoseconds>(now - due).count());
+    }
+
+    if (imu) {
+      SendPacket(cb, *next, next->imu_packet.data(), time);
+      next->next_imu_time += next->imu_period;
+      ++imu_count_;
+    } else {
+      SendPacket(cb, *next, next->packets.data() + next->packet_index * packet_size_, time);
+      next->packet_index = (next->packet_index + 1) % kGeneratorPacketNum;
+      next->next_point_time += next->point_period;
+      point_count_ += kGeneratorPointsPerPacket;
+    }
+  }
+  return packet_count_;
+}
+
+void PacketGenerator::SendPacket(const PacketCallback& cb, VirtualLidar& lidar, uint8_t* data, uint64_t time) {
+  LivoxLidarEthernetPacket* packet = reinterpret_cast<LivoxLidarEthernetPacket*>(data);
+  uint64_t time_stamp = base_time_ + time;
+  packet->udp_cnt = lidar.udp_cnt++;
+  memcpy(packet->timestamp, &time_stamp, sizeof(time_stamp));
+  cb(lidar.handle, lidar.dev_type, packet);
+  ++packet_count_;
+}
+
+} // namespace livox_ros
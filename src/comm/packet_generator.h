@@ -0,0 +1,113 @@
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2022 Livox. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+
+#ifndef LIVOX_ROS_DRIVER_PACKET_GENERATOR_H_
+#define LIVOX_ROS_DRIVER_PACKET_GENERATOR_H_
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "livox_lidar_def.h"
+#include "comm/packet_replayer.h"
+
+namespace livox_ros {
+
+typedef struct {
+  uint32_t lidar_num;  /**< virtual lidars, 1 to kMaxSourceLidar */
+  uint8_t dev_type;    /**< kLivoxLidarTypeMid360, kLivoxLidarTypeIndustrialHAP, 0 alternates both */
+  uint8_t data_type;   /**< LivoxLidarPointDataType of the point packets */
+  uint32_t point_rate; /**< points/s per lidar, 0 for the device rate */
+  uint32_t imu_rate;   /**< Hz per lidar, 0 for no imu packets */
+  bool time_sync;      /**< PTP stamps from the system clock, else unsynced lidar uptime */
+  double duration;     /**< s, 0 runs until stopped */
+} PacketGeneratorConfig;
+
+const uint32_t kMid360PointRate = 200000;
+const uint32_t kHapPointRate = 452000;
+const uint32_t kDefaultSyntheticImuRate = 200;
+const uint32_t kGeneratorPointsPerPacket = 96;
+const uint32_t kGeneratorPacketNum = 64;  /**< distinct point packets per lidar, replayed in turn */
+
+/**
+ * Fabricates Mid-360 and HAP point cloud and IMU packets for a number of virtual lidars
+ * (handles 192.168.100.1 and up) on the schedule real devices would send them. The point
+ * packets are built once, sending one only patches its header, so the generator costs
+ * little next to the driver it loads.
+ */
+class PacketGenerator {
+ public:
+  using PacketCallback = PacketReplayer::PacketCallback;
+
+  PacketGenerator() {}
+  PacketGenerator(const PacketGenerator &) = delete;
+  PacketGenerator &operator=(const PacketGenerator &) = delete;
+
+  /** out of range values are clamped or replaced by defaults */
+  bool Init(const PacketGeneratorConfig& config);
+
+  /** sends packets on the calling thread until duration elapses or quit is set */
+  uint64_t Run(const PacketCallback& cb, const std::atomic<bool>* quit = nullptr);
+
+  const PacketGeneratorConfig& GetConfig() { return config_; }
+  /** handles of the virtual lidars, known from Init on */
+  std::vector<uint32_t> GetHandles();
+  uint64_t GetPacketCount() { return packet_count_; }
+  uint64_t GetPointCount() { return point_count_; }
+  uint64_t GetImuCount() { return imu_count_; }
+  /** ns the sender fell furthest behind its schedule, the load it could not keep up with */
+  uint64_t GetMaxLag() { return max_lag_; }
+
+ private:
+  typedef struct {
+    uint32_t handle;
+    uint8_t dev_type;
+    uint64_t point_period;   /**< ns per point packet */
+    uint64_t imu_period;     /**< ns per imu packet, 0 for none */
+    uint64_t next_point_time;
+    uint64_t next_imu_time;
+    uint16_t udp_cnt;
+    uint32_t packet_index;
+    std::vector<uint8_t> packets;  /**< kGeneratorPacketNum point packets */
+    std::vector<uint8_t> imu_packet;
+  } VirtualLidar;
+
+  void BuildPackets(VirtualLidar& lidar);
+  void SendPacket(const PacketCallback& cb, VirtualLidar& lidar, uint8_t* data, uint64_t time);
+
+  PacketGeneratorConfig config_;
+  uint32_t packet_size_ = 0;
+  std::vector<VirtualLidar> lidars_;
+  uint64_t base_time_ = 0;  /**< ns added to the schedule for the packet stamps */
+
+  uint64_t packet_count_ = 0;
+  uint64_t point_count_ = 0;
+  uint64_t imu_count_ = 0;
+  uint64_t max_lag_ = 0;
+};
+
+} // namespace livox_ros
+
+#endif // LIVOX_ROS_DRIVER_PACKET_GENERATOR_H_
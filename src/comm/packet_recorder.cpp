@@ -0,0 +1,249 @@
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2022 Livox. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+
+#include "packet_recorder.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <chrono>
+
+#include "comm/comm.h"
+
+namespace livox_ros {
+
+static_assert(sizeof(PacketRecordFileHeader) == 32, "capture file header must be 32 bytes");
+static_assert(sizeof(PacketRecordHeader) == 15, "capture record header must be 15 bytes");
+
+namespace {
+
+uint64_t NowNs(std::chrono::steady_clock::time_point time) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+uint64_t NowNs(std::chrono::system_clock::time_point time) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+} // namespace
+
+bool PacketRecorder::Start(const std::string& path, uint32_t chunk_size, uint32_t chunk_num) {
+  if (IsRecording()) {
+    printf("Packet record is already started.\n");
+    return false;
+  }
+  if (chunk_num < 2 || chunk_size < sizeof(PacketRecordHeader) + KEthPacketMaxLength) {
+    printf("Invalid packet record chunks, size:%u, num:%u.\n", chunk_size, chunk_num);
+    return false;
+  }
+
+  fd_ = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd_ < 0) {
+    printf("Open packet record file failed, path:%s, error:%s.\n", path.c_str(), strerror(errno));
+    return false;
+  }
+
+  PacketRecordFileHeader header;
+  memcpy(header.magic, kPacketRecordMagic, sizeof(header.magic));
+  header.version = kPacketRecordVersion;
+  header.header_size = sizeof(PacketRecordFileHeader);
+  header.start_system_time = NowNs(std::chrono::system_clock::now());
+  header.start_steady_time = NowNs(std::chrono::steady_clock::now());
+  if (!WriteAll(&header, sizeof(header))) {
+    close(fd_);
+    fd_ = -1;
+    return false;
+  }
+  file_offset_ = sizeof(header);
+
+  chunk_size_ = chunk_size;
+  chunks_.resize(chunk_num);
+  free_chunks_.clear();
+  for (auto& chunk : chunks_) {
+    chunk.data.reset(new uint8_t[chunk_size_]);
+    // fault the pages in now, not on the receive thread's first copy into each chunk
+    memset(chunk.data.get(), 0, chunk_size_);
+    chunk.used = 0;
+    chunk.record_num = 0;
+    chunk.first_arrival_time = 0;
+    free_chunks_.push_back(&chunk);
+  }
+  current_ = nullptr;
+  full_chunks_.clear();
+  index_.clear();
+  record_num_.store(0);
+  dropped_.store(0);
+  quit_ = false;
+
+  writer_thread_ = std::make_shared<std::thread>(&PacketRecorder::WriterThread, this);
+  recording_.store(true, std::memory_order_release);
+  printf("Start packet record, path:%s, buffer:%u x %u bytes.\n", path.c_str(), chunk_num, chunk_size);
+  return true;
+}
+
+void PacketRecorder::Stop() {
+  if (!IsRecording()) {
+    return;
+  }
+  recording_.store(false, std::memory_order_release);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (current_ && current_->used != 0) {
+      full_chunks_.push_back(current_);
+    }
+    current_ = nullptr;
+    quit_ = true;
+  }
+  cv_.notify_one();
+  if (writer_thread_ && writer_thread_->joinable()) {
+    writer_thread_->join();
+  }
+  writer_thread_ = nullptr;
+
+  PacketRecordFooter footer;
+  footer.index_offset = file_offset_;
+  footer.index_num = static_cast<uint32_t>(index_.size());
+  footer.record_num = record_num_.load();
+  footer.dropped = dropped_.load();
+  memcpy(footer.magic, kPacketRecordMagic, sizeof(footer.magic));
+  WriteAll(index_.data(), index_.size() * sizeof(PacketRecordIndexEntry));
+  WriteAll(&footer, sizeof(footer));
+  close(fd_);
+  fd_ = -1;
+
+  printf("Stop packet record, records:%" PRIu64 ", dropped:%" PRIu64 ", bytes:%" PRIu64 ".\n", footer.record_num,
+         footer.dropped, footer.index_offset);
+  chunks_.clear();
+  free_chunks_.clear();
+  index_.clear();
+}
+
+void PacketRecorder::Record(uint32_t handle, uint8_t dev_type, const LivoxLidarEthernetPacket* data) {
+  PacketRecordHeader header;
+  header.arrival_time = NowNs(std::chrono::steady_clock::now());
+  header.handle = handle;
+  header.dev_type = dev_type;
+  header.length = data->length;
+  const uint32_t record_size = sizeof(PacketRecordHeader) + header.length;
+  if (header.length < sizeof(LivoxLidarEthernetPacket) - 1 || record_size > chunk_size_) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  bool notify = false;
+  bool recorded = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (quit_) {
+      return;
+    }
+    if (current_ == nullptr || current_->used + record_size > chunk_size_) {
+      if (current_ != nullptr) {
+        full_chunks_.push_back(current_);
+        current_ = nullptr;
+        notify = true;
+      }
+      if (!free_chunks_.empty()) {
+        current_ = free_chunks_.back();
+        free_chunks_.pop_back();
+        current_->used = 0;
+        current_->record_num = 0;
+        current_->first_arrival_time = header.arrival_time;
+      }
+    }
+    if (current_ != nullptr) {
+      uint8_t* dst = current_->data.get() + current_->used;
+      memcpy(dst, &header, sizeof(header));
+      memcpy(dst + sizeof(header), data, header.length);
+      current_->used += record_size;
+      current_->record_num++;
+      recorded = true;
+    }
+  }
+  if (notify) {
+    cv_.notify_one();
+  }
+
+  if (!recorded) {
+    uint64_t dropped = dropped_.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (ShouldLogCount(dropped)) {
+      printf("Packet record buffers are full, dropped packets:%" PRIu64 ".\n", dropped);
+    }
+    return;
+  }
+  record_num_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void PacketRecorder::WriterThread() {
+  while (true) {
+    Chunk* chunk = nullptr;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait(lock, [this] { return quit_ || !full_chunks_.empty(); });
+      if (full_chunks_.empty()) {
+        break;
+      }
+      chunk = full_chunks_.front();
+      full_chunks_.pop_front();
+    }
+
+    PacketRecordIndexEntry entry;
+    entry.offset = file_offset_;
+    entry.arrival_time = chunk->first_arrival_time;
+    entry.record_num = chunk->record_num;
+    if (WriteAll(chunk->data.get(), chunk->used)) {
+      index_.push_back(entry);
+      file_offset_ += chunk->used;
+    } else {
+      dropped_.fetch_add(chunk->record_num, std::memory_order_relaxed);
+      record_num_.fetch_sub(chunk->record_num, std::memory_order_relaxed);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    free_chunks_.push_back(chunk);
+  }
+}
+
+bool PacketRecorder::WriteAll(const void* data, size_t size) {
+  const uint8_t* ptr = static_cast<const uint8_t*>(data);
+  while (size > 0) {
+    ssize_t ret = write(fd_, ptr, size);
+    if (ret < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      printf("Write packet record file failed, error:%s.\n", strerror(errno));
+      return false;
+    }
+    ptr += ret;
+    size -= static_cast<size_t>(ret);
+  }
+  return true;
+}
+
+} // namespace livox_ros
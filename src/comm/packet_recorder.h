@@ -0,0 +1,146 @@
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2022 Livox. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+
+#ifndef LIVOX_ROS_DRIVER_PACKET_RECORDER_H_
+#define LIVOX_ROS_DRIVER_PACKET_RECORDER_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "livox_lidar_def.h"
+
+namespace livox_ros {
+
+/**
+ * Packet capture file, as written by PacketRecorder:
+ *   PacketRecordFileHeader
+ *   records, each a PacketRecordHeader followed by length bytes of LivoxLidarEthernetPacket
+ *   PacketRecordIndexEntry[index_num], one per written chunk, for seeking by arrival time
+ *   PacketRecordFooter
+ * A capture cut off before Stop has no index or footer, its records can still be read
+ * front to back.
+ */
+#pragma pack(1)
+
+typedef struct {
+  char magic[8];              /**< kPacketRecordMagic */
+  uint32_t version;
+  uint32_t header_size;       /**< sizeof(PacketRecordFileHeader) */
+  uint64_t start_system_time; /**< system clock ns when recording started */
+  uint64_t start_steady_time; /**< steady clock ns at the same moment, arrival times use this clock */
+} PacketRecordFileHeader;
+
+typedef struct {
+  uint64_t arrival_time;  /**< steady clock ns when the SDK callback received the packet */
+  uint32_t handle;
+  uint8_t dev_type;
+  uint16_t length;        /**< bytes of LivoxLidarEthernetPacket that follow */
+} PacketRecordHeader;
+
+typedef struct {
+  uint64_t offset;        /**< file offset of the first record of the chunk */
+  uint64_t arrival_time;  /**< of that first record */
+  uint32_t record_num;
+} PacketRecordIndexEntry;
+
+typedef struct {
+  uint64_t index_offset;
+  uint32_t index_num;
+  uint64_t record_num;
+  uint64_t dropped;       /**< packets not recorded because every chunk was full */
+  char magic[8];          /**< kPacketRecordMagic */
+} PacketRecordFooter;
+
+#pragma pack()
+
+constexpr char kPacketRecordMagic[8] = {'L', 'V', 'X', 'P', 'C', 'A', 'P', '\0'};
+constexpr uint32_t kPacketRecordVersion = 1;
+constexpr uint32_t kPacketRecordChunkSize = 4 * 1024 * 1024;
+constexpr uint32_t kPacketRecordChunkNum = 16;  /**< about 1 s of 8 lidars at full rate */
+
+/**
+ * Appends every packet the SDK delivers to a capture file. Record copies the packet into
+ * the current chunk under a short lock and returns, a background thread writes full
+ * chunks. When all chunks are waiting for the disk the packet is dropped and counted,
+ * the receive thread never waits for I/O.
+ */
+class PacketRecorder {
+ public:
+  PacketRecorder() {}
+  ~PacketRecorder() { Stop(); }
+  PacketRecorder(const PacketRecorder &) = delete;
+  PacketRecorder &operator=(const PacketRecorder &) = delete;
+
+  bool Start(const std::string& path, uint32_t chunk_size = kPacketRecordChunkSize,
+             uint32_t chunk_num = kPacketRecordChunkNum);
+  /** flushes the pending chunks and writes the index and footer */
+  void Stop();
+  bool IsRecording() { return recording_.load(std::memory_order_acquire); }
+
+  /** called from the SDK receive thread */
+  void Record(uint32_t handle, uint8_t dev_type, const LivoxLidarEthernetPacket* data);
+
+  uint64_t GetRecordCount() { return record_num_.load(std::memory_order_relaxed); }
+  uint64_t GetDropCount() { return dropped_.load(std::memory_order_relaxed); }
+
+ private:
+  typedef struct {
+    std::unique_ptr<uint8_t[]> data;
+    uint32_t used;
+    uint32_t record_num;
+    uint64_t first_arrival_time;
+  } Chunk;
+
+  void WriterThread();
+  bool WriteAll(const void* data, size_t size);
+
+  int fd_ = -1;
+  uint32_t chunk_size_ = 0;
+  std::vector<Chunk> chunks_;
+  Chunk* current_ = nullptr;
+  std::vector<Chunk*> free_chunks_;
+  std::deque<Chunk*> full_chunks_;
+  std::vector<PacketRecordIndexEntry> index_;  /**< only touched by the writer */
+  uint64_t file_offset_ = 0;
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::shared_ptr<std::thread> writer_thread_;
+  std::atomic<bool> recording_{false};
+  bool quit_ = false;
+  std::atomic<uint64_t> record_num_{0};
+  std::atomic<uint64_t> dropped_{0};
+};
+
+} // namespace livox_ros
+
+#endif // LIVOX_ROS_DRIVER_PACKET_RECORDER_H_
@@ -0,0 +1,364 @@
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2022 Livox. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+
+#include "packet_replayer.h"
+
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <thread>
+
+#include "comm/packet_recorder.h"
+
+namespace livox_ros {
+
+namespace {
+
+const uint32_t kPcapMagicMicro = 0xa1b2c3d4;
+const uint32_t kPcapMagicNano = 0xa1b23c4d;
+const uint32_t kPcapMagicMicroSwapped = 0xd4c3b2a1;
+const uint32_t kPcapMagicNanoSwapped = 0x4d3cb2a1;
+const uint32_t kPcapngMagic = 0x0a0d0d0a;
+const uint32_t kPcapGlobalHeaderSize = 24;
+const uint32_t kPcapRecordHeaderSize = 16;
+
+const uint32_t kLinkTypeEthernet = 1;
+const uint32_t kLinkTypeRawIp = 101;
+const uint32_t kLinkTypeLinuxSll = 113;
+const uint32_t kLinkTypeLinuxSll2 = 276;
+
+const uint16_t kEtherTypeIpv4 = 0x0800;
+const uint16_t kEtherTypeVlan = 0x8100;
+const uint16_t kEtherTypeQinQ = 0x88a8;
+const uint8_t kIpProtoUdp = 17;
+const uint32_t kUdpHeaderSize = 8;
+
+// LivoxLidarEthernetPacket without its one byte data placeholder
+const uint32_t kEthPacketHeaderSize = sizeof(LivoxLidarEthernetPacket) - 1;
+const uint32_t kMaxPacketSize = 65536;
+
+inline uint16_t ReadBe16(const uint8_t* p) {
+  return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+uint8_t GetDevTypeByPort(uint16_t port) {
+  if (port == kMid360PointDataPort || port == kMid360ImuDataPort) {
+    return LivoxLidarDeviceType::kLivoxLidarTypeMid360;
+  } else if (port == kHapPointDataPort || port == kHapImuDataPort) {
+    return LivoxLidarDeviceType::kLivoxLidarTypeIndustrialHAP;
+  }
+  return 0;
+}
+
+} // namespace
+
+bool PacketReplayer::Open(const std::string& path) {
+  Close();
+  fd_ = open(path.c_str(), O_RDONLY);
+  if (fd_ < 0) {
+    printf("Open packet replay file failed, path:%s.\n", path.c_str());
+    return false;
+  }
+
+  struct stat file_stat;
+  if (fstat(fd_, &file_stat) != 0 || file_stat.st_size == 0) {
+    printf("Packet replay file is empty or can not be read, path:%s.\n", path.c_str());
+    Close();
+    return false;
+  }
+  file_size_ = static_cast<uint64_t>(file_stat.st_size);
+
+  void* data = mmap(nullptr, file_size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+  if (data == MAP_FAILED) {
+    printf("Map packet replay file failed, path:%s, size:%" PRIu64 ".\n", path.c_str(), file_size_);
+    file_size_ = 0;
+    Close();
+    return false;
+  }
+  madvise(data, file_size_, MADV_SEQUENTIAL);
+  file_data_ = static_cast<const uint8_t*>(data);
+
+  if (!DetectFormat()) {
+    Close();
+    return false;
+  }
+  packet_.resize(kMaxPacketSize);
+  printf("Open packet replay file, path:%s, format:%s, size:%" PRIu64 ".\n", path.c_str(),
+         (format_ == kPacketFileCapture) ? "capture" : "pcap", file_size_);
+  return true;
+}
+
+void PacketReplayer::Close() {
+  if (file_data_) {
+    munmap(const_cast<uint8_t*>(file_data_), file_size_);
+    file_data_ = nullptr;
+  }
+  if (fd_ >= 0) {
+    close(fd_);
+    fd_ = -1;
+  }
+  file_size_ = 0;
+  format_ = kPacketFileUnknown;
+}
+
+bool PacketReplayer::DetectFormat() {
+  if (file_size_ >= sizeof(PacketRecordFileHeader) &&
+      memcmp(file_data_, kPacketRecordMagic, sizeof(kPacketRecordMagic)) == 0) {
+    PacketRecordFileHeader header;
+    memcpy(&header, file_data_, sizeof(header));
+    if (header.version != kPacketRecordVersion || header.header_size < sizeof(header) ||
+        header.header_size > file_size_) {
+      printf("Unsupported packet capture, version:%u, header size:%u.\n",
+             header.version, header.header_size);
+      return false;
+    }
+    format_ = kPacketFileCapture;
+    data_offset_ = header.header_size;
+    data_end_ = file_size_;
+
+    // a capture closed by Stop ends with the index, the records stop where it starts
+    PacketRecordFooter footer;
+    if (file_size_ >= data_offset_ + sizeof(footer)) {
+      memcpy(&footer, file_data_ + file_size_ - sizeof(footer), sizeof(footer));
+      if (memcmp(footer.magic, kPacketRecordMagic, sizeof(kPacketRecordMagic)) == 0 &&
+          footer.index_offset >= data_offset_ && footer.index_offset <= file_size_) {
+        data_end_ = footer.index_offset;
+      }
+    }
+    return true;
+  }
+
+  if (file_size_ < kPcapGlobalHeaderSize) {
+    printf("Packet replay file is too short, size:%" PRIu64 ".\n", file_size_);
+    return false;
+  }
+  uint32_t magic = 0;
+  memcpy(&magic, file_data_, sizeof(magic));
+  if (magic == kPcapMagicMicro || magic == kPcapMagicNano) {
+    pcap_swapped_ = false;
+  } else if (magic == kPcapMagicMicroSwapped || magic == kPcapMagicNanoSwapped) {
+    pcap_swapped_ = true;
+  } else if (magic == kPcapngMagic) {
+    printf("Pcapng is not supported, convert it with 'editcap -F pcap'.\n");
+    return false;
+  } else {
+    printf("Unknown packet replay file, magic:0x%x.\n", magic);
+    return false;
+  }
+  pcap_nanosecond_ = (magic == kPcapMagicNano || magic == kPcapMagicNanoSwapped);
+  pcap_link_type_ = PcapU32(file_data_ + 20) & 0xffff;
+  if (pcap_link_type_ != kLinkTypeEthernet && pcap_link_type_ != kLinkTypeRawIp &&
+      pcap_link_type_ != kLinkTypeLinuxSll && pcap_link_type_ != kLinkTypeLinuxSll2) {
+    printf("Unsupported pcap link type:%u.\n", pcap_link_type_);
+    return false;
+  }
+  format_ = kPacketFilePcap;
+  data_offset_ = kPcapGlobalHeaderSize;
+  data_end_ = file_size_;
+  return true;
+}
+
+uint64_t PacketReplayer::Replay(const PacketCallback& cb, double rate, const std::atomic<bool>* quit) {
+  packet_count_ = 0;
+  skip_count_ = 0;
+  first_time_ = 0;
+  last_time_ = 0;
+  if (file_data_ == nullptr || !cb) {
+    return 0;
+  }
+
+  offset_ = data_offset_;
+  auto start = std::chrono::steady_clock::now();
+  PacketView view;
+  while ((quit == nullptr || !quit->load()) && NextPacket(view)) {
+    if (packet_count_ == 0) {
+      first_time_ = view.time;
+      last_time_ = view.time;
+    } else if (view.time > last_time_) {
+      // packets stamped out of order go out right away
+      last_time_ = view.time;
+    }
+    if (rate > 0.0) {
+      auto due = start + std::chrono::nanoseconds(
+          static_cast<uint64_t>((last_time_ - first_time_) / rate));
+      if (due > std::chrono::steady_clock::now()) {
+        std::this_thread::sleep_until(due);
+      }
+    }
+
+    memcpy(packet_.data(), view.data, view.length);
+    cb(view.handle, view.dev_type, reinterpret_cast<LivoxLidarEthernetPacket*>(packet_.data()));
+    ++packet_count_;
+  }
+  return packet_count_;
+}
+
+std::vector<uint32_t> PacketReplayer::ScanHandles() {
+  std::vector<uint32_t> handles;
+  if (file_data_ == nullptr) {
+    return handles;
+  }
+
+  // headers are parsed only, nothing is copied or passed on
+  offset_ = data_offset_;
+  PacketView view;
+  while (NextPacket(view)) {
+    if (std::find(handles.begin(), handles.end(), view.handle) == handles.end()) {
+      handles.push_back(view.handle);
+    }
+  }
+  skip_count_ = 0;
+  return handles;
+}
+
+bool PacketReplayer::NextPacket(PacketView& view) {
+  if (format_ == kPacketFileCapture) {
+    return NextCapturePacket(view);
+  } else if (format_ == kPacketFilePcap) {
+    return NextPcapPacket(view);
+  }
+  return false;
+}
+
+bool PacketReplayer::NextCapturePacket(PacketView& view) {
+  if (offset_ + sizeof(PacketRecordHeader) > data_end_) {
+    return false;
+  }
+  PacketRecordHeader header;
+  memcpy(&header, file_data_ + offset_, sizeof(header));
+  if (header.length < kEthPacketHeaderSize ||
+      offset_ + sizeof(header) + header.length > data_end_) {
+    printf("Packet capture record at %" PRIu64 " is truncated, stop replay.\n", offset_);
+    return false;
+  }
+  view.time = header.arrival_time;
+  view.handle = header.handle;
+  view.dev_type = header.dev_type;
+  view.data = file_data_ + offset_ + sizeof(header);
+  view.length = header.length;
+  offset_ += sizeof(header) + header.length;
+  return true;
+}
+
+bool PacketReplayer::NextPcapPacket(PacketView& view) {
+  while (offset_ + kPcapRecordHeaderSize <= data_end_) {
+    const uint8_t* record = file_data_ + offset_;
+    uint32_t ts_sec = PcapU32(record);
+    uint32_t ts_frac = PcapU32(record + 4);
+    uint32_t incl_len = PcapU32(record + 8);
+    if (offset_ + kPcapRecordHeaderSize + incl_len > data_end_) {
+      printf("Pcap record at %" PRIu64 " is truncated, stop replay.\n", offset_);
+      return false;
+    }
+    offset_ += kPcapRecordHeaderSize + incl_len;
+
+    if (ParsePcapFrame(record + kPcapRecordHeaderSize, incl_len, view)) {
+      view.time = static_cast<uint64_t>(ts_sec) * 1000000000 +
+                  static_cast<uint64_t>(ts_frac) * (pcap_nanosecond_ ? 1 : 1000);
+      return true;
+    }
+    ++skip_count_;
+  }
+  return false;
+}
+
+bool PacketReplayer::ParsePcapFrame(const uint8_t* frame, uint32_t size, PacketView& view) {
+  uint32_t ip_offset = 0;
+  uint16_t ether_type = kEtherTypeIpv4;
+  if (pcap_link_type_ == kLinkTypeEthernet) {
+    ip_offset = 14;
+    if (size < ip_offset) {
+      return false;
+    }
+    ether_type = ReadBe16(frame + 12);
+    while ((ether_type == kEtherTypeVlan || ether_type == kEtherTypeQinQ) && size >= ip_offset + 4) {
+      ether_type = ReadBe16(frame + ip_offset + 2);
+      ip_offset += 4;
+    }
+  } else if (pcap_link_type_ == kLinkTypeLinuxSll) {
+    ip_offset = 16;
+    if (size < ip_offset) {
+      return false;
+    }
+    ether_type = ReadBe16(frame + 14);
+  } else if (pcap_link_type_ == kLinkTypeLinuxSll2) {
+    ip_offset = 20;
+    if (size < ip_offset) {
+      return false;
+    }
+    ether_type = ReadBe16(frame);
+  }
+  if (ether_type != kEtherTypeIpv4 || size < ip_offset + 20) {
+    return false;
+  }
+
+  const uint8_t* ip = frame + ip_offset;
+  uint32_t ip_header_size = (ip[0] & 0x0f) * 4;
+  // lidar packets fit in one datagram, fragments are not reassembled
+  bool fragment = (ReadBe16(ip + 6) & 0x3fff) != 0;
+  if ((ip[0] >> 4) != 4 || ip[9] != kIpProtoUdp || fragment || ip_header_size < 20 ||
+      size < ip_offset + ip_header_size + kUdpHeaderSize) {
+    return false;
+  }
+
+  const uint8_t* udp = ip + ip_header_size;
+  uint8_t dev_type = GetDevTypeByPort(ReadBe16(udp));
+  uint32_t udp_length = ReadBe16(udp + 4);
+  uint32_t captured = size - ip_offset - ip_header_size;
+  if (dev_type == 0 || udp_length < kUdpHeaderSize + kEthPacketHeaderSize || udp_length > captured) {
+    return false;
+  }
+
+  // a payload cut short by the snap length would make the decoder read past it
+  const uint8_t* payload = udp + kUdpHeaderSize;
+  uint32_t payload_length = udp_length - kUdpHeaderSize;
+  uint16_t packet_length = 0;
+  memcpy(&packet_length, payload + offsetof(LivoxLidarEthernetPacket, length), sizeof(packet_length));
+  if (packet_length > payload_length) {
+    return false;
+  }
+
+  // the same in memory byte order as the handle the SDK derives from the lidar ip
+  memcpy(&view.handle, ip + 12, sizeof(view.handle));
+  view.dev_type = dev_type;
+  view.data = payload;
+  view.length = static_cast<uint16_t>(payload_length);
+  return true;
+}
+
+uint32_t PacketReplayer::PcapU32(const uint8_t* p) {
+  uint32_t value = 0;
+  memcpy(&value, p, sizeof(value));
+  return pcap_swapped_ ? __builtin_bswap32(value) : value;
+}
+
+} // namespace livox_ros
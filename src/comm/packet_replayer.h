@@ -0,0 +1,125 @@
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2022 Livox. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+
+#ifndef LIVOX_ROS_DRIVER_PACKET_REPLAYER_H_
+#define LIVOX_ROS_DRIVER_PACKET_REPLAYER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "livox_lidar_def.h"
+
+namespace livox_ros {
+
+typedef enum {
+  kPacketFileUnknown = 0,
+  kPacketFileCapture = 1,  /**< written by PacketRecorder */
+  kPacketFilePcap = 2,     /**< libpcap capture of the lidar UDP traffic */
+} PacketFileFormat;
+
+/** lidar side ports of the point and imu data, the host side port may be configured */
+const uint16_t kMid360PointDataPort = 56300;
+const uint16_t kMid360ImuDataPort = 56400;
+const uint16_t kHapPointDataPort = 57000;
+const uint16_t kHapImuDataPort = 58000;
+
+/**
+ * Reads the packets of a PacketRecorder capture or a pcap file and hands each one to a
+ * callback with the arguments the SDK passes to its point cloud observer, so a replay
+ * enters the driver exactly where live data does. In a pcap the lidar is told by the
+ * UDP source port, the handle is its IPv4 address like the SDK's.
+ */
+class PacketReplayer {
+ public:
+  using PacketCallback = std::function<void(uint32_t handle, uint8_t dev_type,
+                                            LivoxLidarEthernetPacket* data)>;
+
+  PacketReplayer() {}
+  ~PacketReplayer() { Close(); }
+  PacketReplayer(const PacketReplayer &) = delete;
+  PacketReplayer &operator=(const PacketReplayer &) = delete;
+
+  bool Open(const std::string& path);
+  void Close();
+  PacketFileFormat GetFormat() { return format_; }
+
+  /**
+   * Replays every packet on the calling thread. rate 1.0 keeps the recorded timing, N
+   * compresses it N times, 0 feeds the packets as fast as cb returns. Stops early when
+   * quit is set, returns the number of packets passed to cb.
+   */
+  uint64_t Replay(const PacketCallback& cb, double rate, const std::atomic<bool>* quit = nullptr);
+
+  /** handles of every lidar in the file in order of their first packet, without replaying it */
+  std::vector<uint32_t> ScanHandles();
+
+  uint64_t GetPacketCount() { return packet_count_; }
+  /** pcap frames that are not lidar point or imu packets */
+  uint64_t GetSkipCount() { return skip_count_; }
+  /** ns between the first and the last replayed packet on the recorded timeline */
+  uint64_t GetDuration() { return last_time_ - first_time_; }
+
+ private:
+  typedef struct {
+    uint64_t time;       /**< ns, capture arrival time or pcap timestamp */
+    uint32_t handle;
+    uint8_t dev_type;
+    const uint8_t* data; /**< LivoxLidarEthernetPacket */
+    uint16_t length;
+  } PacketView;
+
+  bool DetectFormat();
+  bool NextPacket(PacketView& view);
+  bool NextCapturePacket(PacketView& view);
+  bool NextPcapPacket(PacketView& view);
+  bool ParsePcapFrame(const uint8_t* frame, uint32_t size, PacketView& view);
+  uint32_t PcapU32(const uint8_t* p);
+
+  int fd_ = -1;
+  const uint8_t* file_data_ = nullptr;
+  uint64_t file_size_ = 0;
+  PacketFileFormat format_ = kPacketFileUnknown;
+  uint64_t data_offset_ = 0;   /**< first record */
+  uint64_t data_end_ = 0;      /**< end of the records, the capture index starts here */
+  uint64_t offset_ = 0;
+
+  // pcap global header
+  bool pcap_swapped_ = false;
+  bool pcap_nanosecond_ = false;
+  uint32_t pcap_link_type_ = 0;
+
+  std::vector<uint8_t> packet_;  /**< the callback gets a writable copy, not the read only map */
+  uint64_t packet_count_ = 0;
+  uint64_t skip_count_ = 0;
+  uint64_t first_time_ = 0;
+  uint64_t last_time_ = 0;
+};
+
+} // namespace livox_ros
+
+#endif // LIVOX_ROS_DRIVER_PACKET_REPLAYER_H_
@@ -0,0 +1,430 @@
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2022 Livox. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+
+#include "point_decoder.h"
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "livox_lidar_def.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define LIVOX_ROS_DECODE_AVX2
+#include <immintrin.h>
+#endif
+
+namespace livox_ros {
+
+namespace {
+
+typedef void (*DecodeKernel)(const RawPacket& pkt, uint32_t point_num,
+                             const PointTransform& transform, PointXyzlt* points);
+
+/** without extrinsic the transform is a pure unit scale, only its diagonal is used */
+template <bool kApplyExtrinsic>
+inline void TransformPoint(const PointTransform& tf, float x, float y, float z, PointXyzlt& point) {
+  if (kApplyExtrinsic) {
+    point.x = x * tf.rotation[0][0] + y * tf.rotation[0][1] + z * tf.rotation[0][2] + tf.trans[0];
+    point.y = x * tf.rotation[1][0] + y * tf.rotation[1][1] + z * tf.rotation[1][2] + tf.trans[1];
+    point.z = x * tf.rotation[2][0] + y * tf.rotation[2][1] + z * tf.rotation[2][2] + tf.trans[2];
+  } else {
+    point.x = x * tf.rotation[0][0];
+    point.y = y * tf.rotation[1][1];
+    point.z = z * tf.rotation[2][2];
+  }
+}
+
+/**
+ * kDoubleTime writes the point time as the double timestamp of LivoxPointXyzrtlt, which
+ * shares the PointXyzlt layout, so the records can be published as PointCloud2 as is.
+ */
+template <bool kDoubleTime>
+inline void StorePointTime(PointXyzlt& point, uint64_t time) {
+  if (kDoubleTime) {
+    double timestamp = static_cast<double>(time);
+    memcpy(&point.offset_time, &timestamp, sizeof(timestamp));
+  } else {
+    point.offset_time = time;
+  }
+}
+
+/** decode raw[begin, end) one point at a time, also used for the tail of the vector kernels */
+template <typename RawPoint, bool kApplyExtrinsic, bool kDoubleTime>
+inline void DecodeCartesianRange(const RawPacket& pkt, uint32_t begin, uint32_t end,
+                                 const PointTransform& tf, PointXyzlt* points) {
+  const RawPoint* raw = reinterpret_cast<const RawPoint*>(pkt.raw_data);
+  uint8_t line = (pkt.line_num != 0) ? (begin % pkt.line_num) : 0;
+  for (uint32_t i = begin; i < end; i++) {
+    PointXyzlt& point = points[i];
+    TransformPoint<kApplyExtrinsic>(tf, static_cast<float>(raw[i].x), static_cast<float>(raw[i].y),
+                                    static_cast<float>(raw[i].z), point);
+    point.intensity = raw[i].reflectivity;
+    point.tag = raw[i].tag;
+    point.line = line;
+    StorePointTime<kDoubleTime>(point, pkt.time_stamp + i * pkt.point_interval);
+    if (++line >= pkt.line_num) {
+      line = 0;
+    }
+  }
+}
+
+template <typename RawPoint, bool kApplyExtrinsic, bool kDoubleTime>
+void DecodeCartesianScalar(const RawPacket& pkt, uint32_t point_num,
+                           const PointTransform& transform, PointXyzlt* points) {
+  DecodeCartesianRange<RawPoint, kApplyExtrinsic, kDoubleTime>(pkt, 0, point_num, transform, points);
+}
+
+template <typename RawPoint>
+inline uint32_t GetDecodablePointNum(const RawPacket& pkt) {
+  uint32_t max_point_num = pkt.data_length / sizeof(RawPoint);
+  return (pkt.point_num < max_point_num) ? pkt.point_num : max_point_num;
+}
+
+/**
+ * sin/cos of every raw angle, indexed by hundredths of a degree. The whole uint16 range
+ * is covered so that no range check is needed; valid angles are below 36000.
+ */
+class SphericalTrigTable {
+ public:
+  static constexpr uint32_t kTableSize = 65536;
+
+  SphericalTrigTable() : sin_(kTableSize), cos_(kTableSize) {
+    for (uint32_t i = 0; i < kTableSize; i++) {
+      double rad = i / 100.0 / 180.0 * PI;
+      sin_[i] = static_cast<float>(sin(rad));
+      cos_[i] = static_cast<float>(cos(rad));
+    }
+  }
+
+  float Sin(uint16_t angle) const { return sin_[angle]; }
+  float Cos(uint16_t angle) const { return cos_[angle]; }
+
+ private:
+  std::vector<float> sin_;
+  std::vector<float> cos_;
+};
+
+const SphericalTrigTable& GetSphericalTrigTable() {
+  static const SphericalTrigTable table;
+  return table;
+}
+
+template <bool kApplyExtrinsic, bool kDoubleTime>
+void DecodeSphericalScalar(const RawPacket& pkt, uint32_t point_num,
+                           const PointTransform& transform, PointXyzlt* points) {
+  const SphericalTrigTable& table = GetSphericalTrigTable();
+  const LivoxLidarSpherPoint* raw = reinterpret_cast<const LivoxLidarSpherPoint*>(pkt.raw_data);
+  uint8_t line = 0;
+  for (uint32_t i = 0; i < point_num; i++) {
+    PointXyzlt& point = points[i];
+    // depth stays in mm, the transform scales it to meter together with the rotation
+    float depth = static_cast<float>(raw[i].depth);
+    float sin_theta = table.Sin(raw[i].theta);
+    float src_x = depth * sin_theta * table.Cos(raw[i].phi);
+    float src_y = depth * sin_theta * table.Sin(raw[i].phi);
+    float src_z = depth * table.Cos(raw[i].theta);
+    TransformPoint<kApplyExtrinsic>(transform, src_x, src_y, src_z, point);
+    point.intensity = raw[i].reflectivity;
+    point.tag = raw[i].tag;
+    point.line = line;
+    StorePointTime<kDoubleTime>(point, pkt.time_stamp + i * pkt.point_interval);
+    if (++line >= pkt.line_num) {
+      line = 0;
+    }
+  }
+}
+
+#ifdef LIVOX_ROS_DECODE_AVX2
+
+constexpr uint32_t kAvx2PointsPerLoop = 8;
+
+/** transform 8 points and write them out together with the per point fields */
+template <typename RawPoint, bool kApplyExtrinsic, bool kDoubleTime>
+__attribute__((target("avx2,fma")))
+inline void TransformAndStore8(const RawPacket& pkt, uint32_t begin, const PointTransform& tf,
+                               __m256 x, __m256 y, __m256 z, PointXyzlt* points) {
+  __m256 out_x;
+  __m256 out_y;
+  __m256 out_z;
+  if (kApplyExtrinsic) {
+    out_x = _mm256_fmadd_ps(x, _mm256_set1_ps(tf.rotation[0][0]),
+            _mm256_fmadd_ps(y, _mm256_set1_ps(tf.rotation[0][1]),
+            _mm256_fmadd_ps(z, _mm256_set1_ps(tf.rotation[0][2]), _mm256_set1_ps(tf.trans[0]))));
+    out_y = _mm256_fmadd_ps(x, _mm256_set1_ps(tf.rotation[1][0]),
+            _mm256_fmadd_ps(y, _mm256_set1_ps(tf.rotation[1][1]),
+            _mm256_fmadd_ps(z, _mm256_set1_ps(tf.rotation[1][2]), _mm256_set1_ps(tf.trans[1]))));
+    out_z = _mm256_fmadd_ps(x, _mm256_set1_ps(tf.rotation[2][0]),
+            _mm256_fmadd_ps(y, _mm256_set1_ps(tf.rotation[2][1]),
+            _mm256_fmadd_ps(z, _mm256_set1_ps(tf.rotation[2][2]), _mm256_set1_ps(tf.trans[2]))));
+  } else {
+    out_x = _mm256_mul_ps(x, _mm256_set1_ps(tf.rotation[0][0]));
+    out_y = _mm256_mul_ps(y, _mm256_set1_ps(tf.rotation[1][1]));
+    out_z = _mm256_mul_ps(z, _mm256_set1_ps(tf.rotation[2][2]));
+  }
+
+  // PointXyzlt is packed, so the results go out through a small aligned staging area
+  alignas(32) float xs[kAvx2PointsPerLoop];
+  alignas(32) float ys[kAvx2PointsPerLoop];
+  alignas(32) float zs[kAvx2PointsPerLoop];
+  _mm256_store_ps(xs, out_x);
+  _mm256_store_ps(ys, out_y);
+  _mm256_store_ps(zs, out_z);
+
+  const RawPoint* raw = reinterpret_cast<const RawPoint*>(pkt.raw_data) + begin;
+  uint8_t line = (pkt.line_num != 0) ? (begin % pkt.line_num) : 0;
+  uint64_t offset_time = pkt.time_stamp + begin * pkt.point_interval;
+  PointXyzlt* point = points + begin;
+  for (uint32_t k = 0; k < kAvx2PointsPerLoop; k++, point++) {
+    point->x = xs[k];
+    point->y = ys[k];
+    point->z = zs[k];
+    point->intensity = raw[k].reflectivity;
+    point->tag = raw[k].tag;
+    point->line = line;
+    StorePointTime<kDoubleTime>(*point, offset_time);
+    offset_time += pkt.point_interval;
+    if (++line >= pkt.line_num) {
+      line = 0;
+    }
+  }
+}
+
+template <bool kApplyExtrinsic, bool kDoubleTime>
+__attribute__((target("avx2,fma")))
+void DecodeCartesianHighAvx2(const RawPacket& pkt, uint32_t point_num,
+                             const PointTransform& transform, PointXyzlt* points) {
+  constexpr int32_t kStride = sizeof(LivoxLidarCartesianHighRawPoint);
+  const __m256i index = _mm256_setr_epi32(0, kStride, 2 * kStride, 3 * kStride,
+                                          4 * kStride, 5 * kStride, 6 * kStride, 7 * kStride);
+  uint32_t i = 0;
+  for (; i + kAvx2PointsPerLoop <= point_num; i += kAvx2PointsPerLoop) {
+    const uint8_t* base = pkt.raw_data + i * kStride;
+    // 14 byte points, gather the x, y and z int32 of 8 points
+    __m256i x = _mm256_i32gather_epi32(reinterpret_cast<const int*>(base), index, 1);
+    __m256i y = _mm256_i32gather_epi32(reinterpret_cast<const int*>(base + 4), index, 1);
+    __m256i z = _mm256_i32gather_epi32(reinterpret_cast<const int*>(base + 8), index, 1);
+    TransformAndStore8<LivoxLidarCartesianHighRawPoint, kApplyExtrinsic, kDoubleTime>(
+        pkt, i, transform, _mm256_cvtepi32_ps(x), _mm256_cvtepi32_ps(y), _mm256_cvtepi32_ps(z), points);
+  }
+  DecodeCartesianRange<LivoxLidarCartesianHighRawPoint, kApplyExtrinsic, kDoubleTime>(
+      pkt, i, point_num, transform, points);
+}
+
+template <bool kApplyExtrinsic, bool kDoubleTime>
+__attribute__((target("avx2,fma")))
+void DecodeCartesianLowAvx2(const RawPacket& pkt, uint32_t point_num,
+                            const PointTransform& transform, PointXyzlt* points) {
+  constexpr uint32_t kStride = sizeof(LivoxLidarCartesianLowRawPoint);
+  // each 8 byte point is the dword pair [x|y, z|reflectivity|tag], split even and odd dwords
+  const __m256i deinterleave = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+  uint32_t i = 0;
+  for (; i + kAvx2PointsPerLoop <= point_num; i += kAvx2PointsPerLoop) {
+    const uint8_t* base = pkt.raw_data + i * kStride;
+    __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(base));
+    __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(base + 32));
+    lo = _mm256_permutevar8x32_epi32(lo, deinterleave);
+    hi = _mm256_permutevar8x32_epi32(hi, deinterleave);
+    __m256i xy = _mm256_permute2x128_si256(lo, hi, 0x20);
+    __m256i zrt = _mm256_permute2x128_si256(lo, hi, 0x31);
+    // sign extend the int16 halves
+    __m256i x = _mm256_srai_epi32(_mm256_slli_epi32(xy, 16), 16);
+    __m256i y = _mm256_srai_epi32(xy, 16);
+    __m256i z = _mm256_srai_epi32(_mm256_slli_epi32(zrt, 16), 16);
+    TransformAndStore8<LivoxLidarCartesianLowRawPoint, kApplyExtrinsic, kDoubleTime>(
+        pkt, i, transform, _mm256_cvtepi32_ps(x), _mm256_cvtepi32_ps(y), _mm256_cvtepi32_ps(z), points);
+  }
+  DecodeCartesianRange<LivoxLidarCartesianLowRawPoint, kApplyExtrinsic, kDoubleTime>(
+      pkt, i, point_num, transform, points);
+}
+
+bool CpuSupportsAvx2() {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+}
+
+#endif // LIVOX_ROS_DECODE_AVX2
+
+/** bounds the point number by the packet length and runs the kernel */
+template <typename RawPoint, DecodeKernel kKernel>
+uint32_t DecodePacket(const RawPacket& pkt, const PointTransform& transform, PointXyzlt* points) {
+  uint32_t point_num = GetDecodablePointNum<RawPoint>(pkt);
+  kKernel(pkt, point_num, transform, points);
+  return point_num;
+}
+
+/** one decode function per data type, extrinsic mode and time layout, chosen for this cpu once */
+class PointDecodeTable {
+ public:
+  static constexpr uint8_t kDataTypeNum = kLivoxLidarSphericalCoordinateData + 1;
+
+  PointDecodeTable() {
+    memset(funcs_, 0, sizeof(funcs_));
+    Fill<true, false>();
+    Fill<false, false>();
+    Fill<true, true>();
+    Fill<false, true>();
+  }
+
+  PointDecodeFunc Get(uint8_t data_type, bool apply_extrinsic, bool double_time) const {
+    if (data_type >= kDataTypeNum) {
+      return nullptr;
+    }
+    return funcs_[data_type][apply_extrinsic ? 1 : 0][double_time ? 1 : 0];
+  }
+
+ private:
+  template <bool kApplyExtrinsic, bool kDoubleTime>
+  void Fill() {
+    typedef LivoxLidarCartesianHighRawPoint HighPoint;
+    typedef LivoxLidarCartesianLowRawPoint LowPoint;
+    const int mode = kApplyExtrinsic ? 1 : 0;
+    const int time = kDoubleTime ? 1 : 0;
+    funcs_[kLivoxLidarCartesianCoordinateHighData][mode][time] =
+        DecodePacket<HighPoint, DecodeCartesianScalar<HighPoint, kApplyExtrinsic, kDoubleTime>>;
+    funcs_[kLivoxLidarCartesianCoordinateLowData][mode][time] =
+        DecodePacket<LowPoint, DecodeCartesianScalar<LowPoint, kApplyExtrinsic, kDoubleTime>>;
+    funcs_[kLivoxLidarSphericalCoordinateData][mode][time] =
+        DecodePacket<LivoxLidarSpherPoint, DecodeSphericalScalar<kApplyExtrinsic, kDoubleTime>>;
+#ifdef LIVOX_ROS_DECODE_AVX2
+    if (IsAvx2DecodeSupported()) {
+      funcs_[kLivoxLidarCartesianCoordinateHighData][mode][time] =
+          DecodePacket<HighPoint, DecodeCartesianHighAvx2<kApplyExtrinsic, kDoubleTime>>;
+      funcs_[kLivoxLidarCartesianCoordinateLowData][mode][time] =
+          DecodePacket<LowPoint, DecodeCartesianLowAvx2<kApplyExtrinsic, kDoubleTime>>;
+    }
+#endif
+  }
+
+  PointDecodeFunc funcs_[kDataTypeNum][2][2];
+};
+
+const PointDecodeTable& GetPointDecodeTable() {
+  static const PointDecodeTable table;
+  return table;
+}
+
+} // namespace
+
+void MakePointTransform(const ExtParameterDetailed* extrinsic, float unit_scale,
+                        PointTransform& transform) {
+  for (int row = 0; row < 3; row++) {
+    for (int col = 0; col < 3; col++) {
+      float value = (row == col) ? 1.0f : 0.0f;
+      if (extrinsic) {
+        value = extrinsic->rotation[row][col];
+      }
+      transform.rotation[row][col] = value * unit_scale;
+    }
+    transform.trans[row] = extrinsic ? extrinsic->trans[row] : 0.0f;
+  }
+}
+
+PointDecodeFunc GetPointDecodeFunc(uint8_t data_type, bool apply_extrinsic, bool double_time) {
+  return GetPointDecodeTable().Get(data_type, apply_extrinsic, double_time);
+}
+
+uint32_t DecodeCartesianHighPoints(const RawPacket& pkt, const PointTransform& transform,
+                                   PointXyzlt* points) {
+  return GetPointDecodeFunc(kLivoxLidarCartesianCoordinateHighData, true, false)(pkt, transform, points);
+}
+
+uint32_t DecodeCartesianLowPoints(const RawPacket& pkt, const PointTransform& transform,
+                                  PointXyzlt* points) {
+  return GetPointDecodeFunc(kLivoxLidarCartesianCoordinateLowData, true, false)(pkt, transform, points);
+}
+
+uint32_t DecodeSphericalPoints(const RawPacket& pkt, const PointTransform& transform,
+                               PointXyzlt* points) {
+  return GetPointDecodeFunc(kLivoxLidarSphericalCoordinateData, true, false)(pkt, transform, points);
+}
+
+uint32_t GetDecodablePointNum(const RawPacket& pkt) {
+  switch (pkt.data_type) {
+    case kLivoxLidarCartesianCoordinateHighData:
+      return GetDecodablePointNum<LivoxLidarCartesianHighRawPoint>(pkt);
+    case kLivoxLidarCartesianCoordinateLowData:
+      return GetDecodablePointNum<LivoxLidarCartesianLowRawPoint>(pkt);
+    case kLivoxLidarSphericalCoordinateData:
+      return GetDecodablePointNum<LivoxLidarSpherPoint>(pkt);
+    default:
+      return 0;
+  }
+}
+
+void InitSphericalDecodeTable() {
+  GetSphericalTrigTable();
+}
+
+void DecodeCartesianHighPointsScalar(const RawPacket& pkt, uint32_t point_num,
+                                     const PointTransform& transform, PointXyzlt* points) {
+  DecodeCartesianScalar<LivoxLidarCartesianHighRawPoint, true, false>(pkt, point_num, transform, points);
+}
+
+void DecodeCartesianLowPointsScalar(const RawPacket& pkt, uint32_t point_num,
+                                    const PointTransform& transform, PointXyzlt* points) {
+  DecodeCartesianScalar<LivoxLidarCartesianLowRawPoint, true, false>(pkt, point_num, transform, points);
+}
+
+#ifdef LIVOX_ROS_DECODE_AVX2
+
+void DecodeCartesianHighPointsAvx2(const RawPacket& pkt, uint32_t point_num,
+                                   const PointTransform& transform, PointXyzlt* points) {
+  DecodeCartesianHighAvx2<true, false>(pkt, point_num, transform, points);
+}
+
+void DecodeCartesianLowPointsAvx2(const RawPacket& pkt, uint32_t point_num,
+                                  const PointTransform& transform, PointXyzlt* points) {
+  DecodeCartesianLowAvx2<true, false>(pkt, point_num, transform, points);
+}
+
+bool IsAvx2DecodeSupported() {
+  static const bool supported = CpuSupportsAvx2();
+  return supported;
+}
+
+#else
+
+void DecodeCartesianHighPointsAvx2(const RawPacket& pkt, uint32_t point_num,
+                                   const PointTransform& transform, PointXyzlt* points) {
+  DecodeCartesianHighPointsScalar(pkt, point_num, transform, points);
+}
+
+void DecodeCartesianLowPointsAvx2(const RawPacket& pkt, uint32_t point_num,
+                                  const PointTransform& transform, PointXyzlt* points) {
+  DecodeCartesianLowPointsScalar(pkt, point_num, transform, points);
+}
+
+bool IsAvx2DecodeSupported() {
+  return false;
+}
+
+#endif // LIVOX_ROS_DECODE_AVX2
+
+const char* GetPointDecodeIsaName() {
+  return IsAvx2DecodeSupported() ? "avx2" : "scalar";
+}
+
+} // namespace livox_ros
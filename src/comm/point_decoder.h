@@ -0,0 +1,103 @@
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2022 Livox. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+
+#ifndef LIVOX_ROS_DRIVER_POINT_DECODER_H_
+#define LIVOX_ROS_DRIVER_POINT_DECODER_H_
+
+#include <cstdint>
+
+#include "comm/comm.h"
+
+namespace livox_ros {
+
+/** Extrinsic rotation with the raw point unit to meter scale folded in, translation in meter. */
+typedef struct {
+  float rotation[3][3];
+  float trans[3];
+} PointTransform;
+
+/**
+ * Build the transform applied by the decode kernels, out = rotation * raw + trans.
+ * extrinsic may be nullptr, then only the unit scale is applied. The extrinsic
+ * translation is in meter for every data type, only the rotation is scaled by unit_scale.
+ */
+void MakePointTransform(const ExtParameterDetailed* extrinsic, float unit_scale,
+                        PointTransform& transform);
+
+typedef uint32_t (*PointDecodeFunc)(const RawPacket& pkt, const PointTransform& transform,
+                                    PointXyzlt* points);
+
+/**
+ * Decode function specialized for the data type, extrinsic mode and time layout, so the
+ * per point loop has no branch on any of them. Without extrinsic only the unit scale on
+ * the diagonal of the transform is applied. With double_time the records are written as
+ * LivoxPointXyzrtlt (double timestamp) instead of PointXyzlt (uint64 offset_time).
+ * Returns nullptr for an unknown data type.
+ */
+PointDecodeFunc GetPointDecodeFunc(uint8_t data_type, bool apply_extrinsic, bool double_time);
+
+/**
+ * Decode the raw points of pkt into points, which must hold at least pkt.point_num
+ * entries. Returns the number of decoded points, which is also bounded by
+ * pkt.data_length. The fastest kernel supported by the cpu is chosen on first use.
+ */
+uint32_t DecodeCartesianHighPoints(const RawPacket& pkt, const PointTransform& transform,
+                                   PointXyzlt* points);
+uint32_t DecodeCartesianLowPoints(const RawPacket& pkt, const PointTransform& transform,
+                                  PointXyzlt* points);
+
+/**
+ * Spherical points are converted with sin/cos tables indexed by the raw hundredths
+ * of a degree, the transform must be built with the depth unit (mm) scale.
+ */
+uint32_t DecodeSphericalPoints(const RawPacket& pkt, const PointTransform& transform,
+                               PointXyzlt* points);
+
+/**
+ * pkt.point_num bounded by the raw points that fit in pkt.data_length, the number the
+ * decode functions return. 0 for an unknown data type.
+ */
+uint32_t GetDecodablePointNum(const RawPacket& pkt);
+
+/** build the spherical trig tables ahead of the first packet, they are built on first use otherwise */
+void InitSphericalDecodeTable();
+
+/** The individual kernels, exposed for benchmarking and verification. */
+void DecodeCartesianHighPointsScalar(const RawPacket& pkt, uint32_t point_num,
+                                     const PointTransform& transform, PointXyzlt* points);
+void DecodeCartesianLowPointsScalar(const RawPacket& pkt, uint32_t point_num,
+                                    const PointTransform& transform, PointXyzlt* points);
+void DecodeCartesianHighPointsAvx2(const RawPacket& pkt, uint32_t point_num,
+                                   const PointTransform& transform, PointXyzlt* points);
+void DecodeCartesianLowPointsAvx2(const RawPacket& pkt, uint32_t point_num,
+                                  const PointTransform& transform, PointXyzlt* points);
+
+/** true when the AVX2 kernels are compiled in and supported by this cpu */
+bool IsAvx2DecodeSupported();
+const char* GetPointDecodeIsaName();
+
+} // namespace livox_ros
+
+#endif // LIVOX_ROS_DRIVER_POINT_DECODER_H_
@@ -0,0 +1,160 @@
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2022 Livox. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+
+#include "pointcloud2_layout.h"
+
+#include <math.h>
+
+namespace livox_ros {
+
+namespace {
+
+static_assert(sizeof(PointCloud2Xyzi) == 16, "XYZI record must be 16 bytes");
+static_assert(sizeof(PointCloud2Xyzit) == 20, "XYZIT record must be 20 bytes");
+static_assert(sizeof(PointCloud2XyziQ16) == 8, "XYZI Q16 record must be 8 bytes");
+static_assert(sizeof(PointCloud2XyziI32) == 14, "XYZI I32 record must be 14 bytes");
+
+uint32_t FillXyzrtlt(const PointXyzlt* points, uint32_t num, uint64_t base_time, uint8_t* dst) {
+  LivoxPointXyzrtlt* dst_points = reinterpret_cast<LivoxPointXyzrtlt*>(dst);
+  for (uint32_t i = 0; i < num; ++i) {
+    LivoxPointXyzrtlt& point = dst_points[i];
+    point.x = points[i].x;
+    point.y = points[i].y;
+    point.z = points[i].z;
+    point.reflectivity = points[i].intensity;
+    point.tag = points[i].tag;
+    point.line = points[i].line;
+    point.timestamp = static_cast<double>(points[i].offset_time);
+  }
+  return num;
+}
+
+uint32_t FillXyzi(const PointXyzlt* points, uint32_t num, uint64_t base_time, uint8_t* dst) {
+  PointCloud2Xyzi* dst_points = reinterpret_cast<PointCloud2Xyzi*>(dst);
+  for (uint32_t i = 0; i < num; ++i) {
+    PointCloud2Xyzi& point = dst_points[i];
+    point.x = points[i].x;
+    point.y = points[i].y;
+    point.z = points[i].z;
+    point.intensity = points[i].intensity;
+  }
+  return num;
+}
+
+uint32_t FillXyzit(const PointXyzlt* points, uint32_t num, uint64_t base_time, uint8_t* dst) {
+  PointCloud2Xyzit* dst_points = reinterpret_cast<PointCloud2Xyzit*>(dst);
+  for (uint32_t i = 0; i < num; ++i) {
+    PointCloud2Xyzit& point = dst_points[i];
+    point.x = points[i].x;
+    point.y = points[i].y;
+    point.z = points[i].z;
+    point.intensity = points[i].intensity;
+    point.offset_time = static_cast<uint32_t>(points[i].offset_time - base_time);
+  }
+  return num;
+}
+
+// Points with a coordinate beyond +-limit units are dropped, a clamped point would land on a
+// false wall at the range boundary. The comparisons are also false for NaN.
+template <typename Record, typename Coord>
+uint32_t FillIntegerXyzi(const PointXyzlt* points, uint32_t num, float units_per_meter, float limit,
+                         uint8_t* dst) {
+  Record* dst_points = reinterpret_cast<Record*>(dst);
+  uint32_t written = 0;
+  for (uint32_t i = 0; i < num; ++i) {
+    float x = points[i].x * units_per_meter;
+    float y = points[i].y * units_per_meter;
+    float z = points[i].z * units_per_meter;
+    if (!((fabsf(x) <= limit) && (fabsf(y) <= limit) && (fabsf(z) <= limit))) {
+      continue;
+    }
+    Record& point = dst_points[written++];
+    point.x = static_cast<Coord>(lrintf(x));
+    point.y = static_cast<Coord>(lrintf(y));
+    point.z = static_cast<Coord>(lrintf(z));
+    point.intensity = static_cast<uint8_t>(points[i].intensity);
+    point.line = points[i].line;
+  }
+  return written;
+}
+
+uint32_t FillXyziQ16(const PointXyzlt* points, uint32_t num, uint64_t base_time, uint8_t* dst) {
+  return FillIntegerXyzi<PointCloud2XyziQ16, int16_t>(points, num, 100.0f, 32767.0f, dst);
+}
+
+uint32_t FillXyziI32(const PointXyzlt* points, uint32_t num, uint64_t base_time, uint8_t* dst) {
+  // float only holds 24 bits of mantissa, so the int32 bound is kept just inside
+  return FillIntegerXyzi<PointCloud2XyziI32, int32_t>(points, num, 1000.0f, 2147483520.0f, dst);
+}
+
+const PointCloud2Layout kPointCloud2Layouts[kPointCloud2LayoutUndef] = {
+  {"XYZRTLT", sizeof(LivoxPointXyzrtlt), 7,
+   {{"x", 0, kPointFieldFloat32},
+    {"y", 4, kPointFieldFloat32},
+    {"z", 8, kPointFieldFloat32},
+    {"intensity", 12, kPointFieldFloat32},
+    {"tag", 16, kPointFieldUint8},
+    {"line", 17, kPointFieldUint8},
+    {"timestamp", 18, kPointFieldFloat64}},
+   FillXyzrtlt, 0.0f},
+  {"XYZI", sizeof(PointCloud2Xyzi), 4,
+   {{"x", 0, kPointFieldFloat32},
+    {"y", 4, kPointFieldFloat32},
+    {"z", 8, kPointFieldFloat32},
+    {"intensity", 12, kPointFieldFloat32}},
+   FillXyzi, 0.0f},
+  {"XYZIT", sizeof(PointCloud2Xyzit), 5,
+   {{"x", 0, kPointFieldFloat32},
+    {"y", 4, kPointFieldFloat32},
+    {"z", 8, kPointFieldFloat32},
+    {"intensity", 12, kPointFieldFloat32},
+    {"offset_time", 16, kPointFieldUint32}},
+   FillXyzit, 0.0f},
+  {"XYZI_Q16", sizeof(PointCloud2XyziQ16), 5,
+   {{"x", 0, kPointFieldInt16},
+    {"y", 2, kPointFieldInt16},
+    {"z", 4, kPointFieldInt16},
+    {"intensity", 6, kPointFieldUint8},
+    {"line", 7, kPointFieldUint8}},
+   FillXyziQ16, kPointCloud2Q16Scale},
+  {"XYZI_I32", sizeof(PointCloud2XyziI32), 5,
+   {{"x", 0, kPointFieldInt32},
+    {"y", 4, kPointFieldInt32},
+    {"z", 8, kPointFieldInt32},
+    {"intensity", 12, kPointFieldUint8},
+    {"line", 13, kPointFieldUint8}},
+   FillXyziI32, kPointCloud2I32Scale},
+};
+
+} // namespace
+
+const PointCloud2Layout* GetPointCloud2Layout(uint8_t layout) {
+  if (layout >= kPointCloud2LayoutUndef) {
+    return nullptr;
+  }
+  return &kPointCloud2Layouts[layout];
+}
+
+} // namespace livox_ros
@@ -0,0 +1,125 @@
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2022 Livox. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+
+#ifndef LIVOX_ROS_DRIVER_POINTCLOUD2_LAYOUT_H_
+#define LIVOX_ROS_DRIVER_POINTCLOUD2_LAYOUT_H_
+
+#include <cstdint>
+
+#include "comm/comm.h"
+
+namespace livox_ros {
+
+/** PointCloud2 point record layouts, selected with the pointcloud2_layout parameter */
+typedef enum {
+  kPointCloud2LayoutXyzrtlt = 0, /**< float xyz, float intensity, tag, line, float64 timestamp, 26 B */
+  kPointCloud2LayoutXyzi = 1,    /**< float xyz, float intensity, 16 B */
+  kPointCloud2LayoutXyzit = 2,   /**< float xyz, float intensity, uint32 ns offset to the stamp, 20 B */
+  kPointCloud2LayoutXyziQ16 = 3, /**< int16 xyz in cm, uint8 intensity, uint8 line, 8 B */
+  kPointCloud2LayoutXyziI32 = 4, /**< int32 xyz in mm, uint8 intensity, uint8 line, 14 B */
+  kPointCloud2LayoutUndef,
+} PointCloud2LayoutType;
+
+#pragma pack(1)
+
+typedef struct {
+  float x;
+  float y;
+  float z;
+  float intensity;
+} PointCloud2Xyzi;
+
+typedef struct {
+  float x;
+  float y;
+  float z;
+  float intensity;
+  uint32_t offset_time;  /**< ns since the message stamp */
+} PointCloud2Xyzit;
+
+typedef struct {
+  int16_t x;  /**< cm, the unit of the cartesian low data */
+  int16_t y;
+  int16_t z;
+  uint8_t intensity;
+  uint8_t line;
+} PointCloud2XyziQ16;
+
+typedef struct {
+  int32_t x;  /**< mm, the unit of the cartesian high data */
+  int32_t y;
+  int32_t z;
+  uint8_t intensity;
+  uint8_t line;
+} PointCloud2XyziI32;
+
+#pragma pack()
+
+/** Field datatypes as numbered by sensor_msgs/PointField */
+typedef enum {
+  kPointFieldInt8 = 1,
+  kPointFieldUint8 = 2,
+  kPointFieldInt16 = 3,
+  kPointFieldUint16 = 4,
+  kPointFieldInt32 = 5,
+  kPointFieldUint32 = 6,
+  kPointFieldFloat32 = 7,
+  kPointFieldFloat64 = 8,
+} PointFieldDataType;
+
+typedef struct {
+  const char* name;
+  uint32_t offset;
+  uint8_t datatype;
+} PointCloud2FieldDesc;
+
+/**
+ * Converts num PointXyzlt records into the layout at dst, base_time is the message stamp.
+ * Returns the number of records written: the integer layouts drop the points their x, y
+ * or z cannot hold instead of clamping them onto the range boundary.
+ */
+typedef uint32_t (*PointCloud2FillFunc)(const PointXyzlt* points, uint32_t num, uint64_t base_time,
+                                        uint8_t* dst);
+
+constexpr float kPointCloud2Q16Scale = 0.01f;   /**< metres per unit of XYZI_Q16, +-327.67 m */
+constexpr float kPointCloud2I32Scale = 0.001f;  /**< metres per unit of XYZI_I32 */
+
+constexpr uint32_t kMaxPointCloud2Fields = 7;
+
+typedef struct {
+  const char* name;
+  uint32_t point_step;
+  uint32_t field_num;
+  PointCloud2FieldDesc fields[kMaxPointCloud2Fields];
+  PointCloud2FillFunc fill;
+  float scale;  /**< metres per unit of the integer xyz, 0 for the float layouts */
+} PointCloud2Layout;
+
+/** Returns nullptr for an unknown layout */
+const PointCloud2Layout* GetPointCloud2Layout(uint8_t layout);
+
+} // namespace livox_ros
+
+#endif // LIVOX_ROS_DRIVER_POINTCLOUD2_LAYOUT_H_
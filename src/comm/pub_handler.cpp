@@ -24,11 +24,17 @@
 
 #include "pub_handler.h"
 
+#include <cinttypes>
 #include <cstdlib>
 #include <chrono>
 #include <iostream>
 #include <limits>
 
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
 namespace livox_ros {
 
 std::atomic<bool> PubHandler::is_timestamp_sync_;
@@ -46,8 +52,10 @@ void PubHandler::Uninit() {
     LivoxLidarRemovePointCloudObserver(lidar_listen_id_);
     lidar_listen_id_ = 0;
   }
+  packet_recorder_.Stop();
 
   RequestExit();
+  raw_packet_queue_.Notify();
 
   if (point_process_thread_ &&
     point_process_thread_->joinable()) {
@@ -56,6 +64,18 @@ void PubHandler::Uninit() {
   } else {
     /* */
   }
+
+  // workers take frame_mutex_ after every packet, so do not hold it while joining them
+  std::vector<LidarPubHandler*> process_handlers;
+  {
+    std::lock_guard<std::mutex> lock(frame_mutex_);
+    for (auto &process_handler : lidar_process_handlers_) {
+      process_handlers.push_back(process_handler.second.get());
+    }
+  }
+  for (auto process_handler : process_handlers) {
+    process_handler->StopProcessThread();
+  }
 }
 
 void PubHandler::RequestExit() {
@@ -66,7 +86,12 @@ void PubHandler::SetPointCloudConfig(const double publish_freq) {
   publish_interval_ = (kNsPerSecond / (publish_freq * 10)) * 10;
   publish_interval_tolerance_ = publish_interval_ - kNsTolerantFrameTimeDeviation;
   publish_interval_ms_ = publish_interval_ / kRatioOfMsToNs;
-  if (!point_process_thread_) {
+  points_per_frame_ = CalculatePointsPerFrame(publish_freq);
+  printf("Point decode kernel:%s.\n", GetPointDecodeIsaName());
+  InitSphericalDecodeTable();
+  if (decode_thread_per_lidar_) {
+    printf("Decode point cloud with one thread per lidar.\n");
+  } else if (!point_process_thread_) {
     point_process_thread_ = std::make_shared<std::thread>(&PubHandler::RawDataProcess, this);
   }
   return;
@@ -77,6 +102,13 @@ void PubHandler::SetImuDataCallback(ImuDataCallback cb, void* client_data) {
   imu_callback_ = cb;
 }
 
+void PubHandler::SetLidarDecodeCpu(const uint32_t handle, const int32_t cpu_id) {
+  std::unique_lock<std::mutex> lock(packet_mutex_);
+  uint32_t id = 0;
+  GetLidarId(kLivoxLidarType, handle, id);
+  lidar_decode_cpus_[id] = cpu_id;
+}
+
 void PubHandler::AddLidarsExtParam(LidarExtParameter& lidar_param) {
   std::unique_lock<std::mutex> lock(packet_mutex_);
   uint32_t id = 0;
@@ -92,7 +124,13 @@ void PubHandler::ClearAllLidarsExtrinsicParams() {
 void PubHandler::SetPointCloudsCallback(PointCloudsCallback cb, void* client_data) {
   pub_client_data_ = client_data;
   points_callback_ = cb;
-  lidar_listen_id_ = LivoxLidarAddPointCloudObserver(OnLivoxLidarPointCloudCallback, this);
+  // the ring must exist before the SDK starts delivering packets
+  if (!decode_thread_per_lidar_) {
+    raw_packet_queue_.Init(packet_queue_size_);
+  }
+  if (sdk_packet_source_) {
+    lidar_listen_id_ = LivoxLidarAddPointCloudObserver(OnLivoxLidarPointCloudCallback, this);
+  }
 }
 
 void PubHandler::OnLivoxLidarPointCloudCallback(uint32_t handle, const uint8_t dev_type,
@@ -102,6 +140,11 @@ void PubHandler::OnLivoxLidarPointCloudCallback(uint32_t handle, const uint8_t d
     return;
   }
 
+  // captured as delivered, before anything below can reject the packet
+  if (self->packet_recorder_.IsRecording()) {
+    self->packet_recorder_.Record(handle, dev_type, data);
+  }
+
   if (data->time_type != kTimestampTypeNoSync) {
     is_timestamp_sync_.store(true);
   } else {
@@ -122,33 +165,48 @@ void PubHandler::OnLivoxLidarPointCloudCallback(uint32_t handle, const uint8_t d
       imu_data.acc_x = imu->acc_x;
       imu_data.acc_y = imu->acc_y;
       imu_data.acc_z = imu->acc_z;
+      imu_data.recv_time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch()).count();
       self->imu_callback_(&imu_data, self->imu_client_data_);
     }
     return;
   }
-  RawPacket packet = {};
-  packet.handle = handle;
-  packet.lidar_type = LidarProtoType::kLivoxLidarType;
-  packet.extrinsic_enable = false; 
+  uint32_t length = data->length - sizeof(LivoxLidarEthernetPacket) + 1;
+  if (length > KEthPacketMaxLength) {
+    printf("Invalid point cloud packet length:%u, handle:%u.\n", length, handle);
+    return;
+  }
+
+  RawPacketQueue* queue = &self->raw_packet_queue_;
+  if (self->decode_thread_per_lidar_) {
+    queue = self->GetLidarProcessHandler(handle)->GetPacketQueue();
+  }
+  RawPacket* packet = queue->PushBegin();
+  if (packet == nullptr) {
+    uint64_t dropped = queue->GetDropCount();
+    if (ShouldLogCount(dropped)) {
+      printf("Raw packet queue is full, handle:%u, dropped packets:%" PRIu64 ".\n", handle, dropped);
+    }
+    return;
+  }
+  packet->handle = handle;
+  packet->lidar_type = LidarProtoType::kLivoxLidarType;
+  packet->extrinsic_enable = false;
   if (dev_type == LivoxLidarDeviceType::kLivoxLidarTypeIndustrialHAP) {
-    packet.line_num = kLineNumberHAP;
+    packet->line_num = kLineNumberHAP;
   } else if (dev_type == LivoxLidarDeviceType::kLivoxLidarTypeMid360) {
-    packet.line_num = kLineNumberMid360;
+    packet->line_num = kLineNumberMid360;
   } else {
-    packet.line_num = kLineNumberDefault;
+    packet->line_num = kLineNumberDefault;
   }
-  packet.data_type = data->data_type;
-  packet.point_num = data->dot_num;
-  packet.point_interval = data->time_interval * 100 / data->dot_num;  //ns
-  packet.time_stamp = GetEthPacketTimestamp(data->time_type,
-                                            data->timestamp, sizeof(data->timestamp));
-  uint32_t length = data->length - sizeof(LivoxLidarEthernetPacket) + 1;
-  packet.raw_data.insert(packet.raw_data.end(), data->data, data->data + length);
-  {
-    std::unique_lock<std::mutex> lock(self->packet_mutex_);
-    self->raw_packet_queue_.push_back(packet);
-  }
-    self->packet_condition_.notify_one();
+  packet->data_type = data->data_type;
+  packet->point_num = data->dot_num;
+  packet->point_interval = data->time_interval * 100 / data->dot_num;  //ns
+  packet->time_stamp = GetEthPacketTimestamp(data->time_type,
+                                             data->timestamp, sizeof(data->timestamp));
+  packet->data_length = length;
+  memcpy(packet->raw_data, data->data, length);
+  queue->PushEnd();
 
   return;
 }
@@ -175,17 +233,17 @@ void PubHandler::CheckTimer(uint32_t id) {
       return;
     }
 
-    frame_.base_time[frame_.lidar_num] = process_handler->GetLidarBaseTime();
     points_[id].clear();
-    process_handler->GetLidarPointClouds(points_[id]);
+    frame_.base_time[frame_.lidar_num] = process_handler->GetLidarPointClouds(points_[id]);
     if (points_[id].empty()) {
       return;
     }
     PointPacket& lidar_point = frame_.lidar_point[frame_.lidar_num];
     lidar_point.lidar_type = LidarProtoType::kLivoxLidarType;  // TODO:
     lidar_point.handle = id;
-    lidar_point.points_num = points_[id].size();
-    lidar_point.points = points_[id].data();
+    lidar_point.points_num = points_[id].size() / kPointRecordSize;
+    lidar_point.points = reinterpret_cast<PointXyzlt*>(points_[id].data());
+    lidar_point.buffer = &points_[id];
     frame_.lidar_num++;
     
     if (frame_.lidar_num != 0) {
@@ -206,18 +264,20 @@ void PubHandler::CheckTimer(uint32_t id) {
     }
     last_pub_time_ += std::chrono::nanoseconds(publish_interval_);
     for (auto &process_handler : lidar_process_handlers_) {
-      frame_.base_time[frame_.lidar_num] = process_handler.second->GetLidarBaseTime();
       uint32_t handle = process_handler.first;
       points_[handle].clear();
-      process_handler.second->GetLidarPointClouds(points_[handle]);
+      // taken with the swapped out points, other lidars may still be decoding
+      uint64_t base_time = process_handler.second->GetLidarPointClouds(points_[handle]);
       if (points_[handle].empty()) {
         continue;
       }
+      frame_.base_time[frame_.lidar_num] = base_time;
       PointPacket& lidar_point = frame_.lidar_point[frame_.lidar_num];
       lidar_point.lidar_type = LidarProtoType::kLivoxLidarType;  // TODO:
       lidar_point.handle = handle;
-      lidar_point.points_num = points_[handle].size();
-      lidar_point.points = points_[handle].data();
+      lidar_point.points_num = points_[handle].size() / kPointRecordSize;
+      lidar_point.points = reinterpret_cast<PointXyzlt*>(points_[handle].data());
+      lidar_point.buffer = &points_[handle];
       frame_.lidar_num++;
     }
     PublishPointCloud();
@@ -227,33 +287,64 @@ void PubHandler::CheckTimer(uint32_t id) {
 }
 
 void PubHandler::RawDataProcess() {
-  RawPacket raw_data;
   while (!is_quit_.load()) {
-    {
-      std::unique_lock<std::mutex> lock(packet_mutex_);
-      if (raw_packet_queue_.empty()) {
-        packet_condition_.wait_for(lock, std::chrono::milliseconds(500));
-        if (raw_packet_queue_.empty()) {
-          continue;
-        }
-      }
-      raw_data = raw_packet_queue_.front();
-      raw_packet_queue_.pop_front();
+    if (!raw_packet_queue_.Wait(500)) {
+      continue;
     }
+    RawPacket* raw_data = raw_packet_queue_.Front();
     uint32_t id = 0;
-    GetLidarId(raw_data.lidar_type, raw_data.handle, id);
+    GetLidarId(raw_data->lidar_type, raw_data->handle, id);
     if (lidar_process_handlers_.find(id) == lidar_process_handlers_.end()) {
       lidar_process_handlers_[id].reset(new LidarPubHandler());
+      lidar_process_handlers_[id]->SetPointsPerFrame(points_per_frame_);
+      lidar_process_handlers_[id]->SetFusedPointCloud2(fused_pointcloud2_);
     }
     auto &process_handler = lidar_process_handlers_[id];
     if (lidar_extrinsics_.find(id) != lidar_extrinsics_.end()) {
         lidar_process_handlers_[id]->SetLidarsExtParam(lidar_extrinsics_[id]);
     }
-    process_handler->PointCloudProcess(raw_data);
+    process_handler->PointCloudProcess(*raw_data);
+    raw_packet_queue_.Pop();
     CheckTimer(id);
   }
 }
 
+LidarPubHandler* PubHandler::GetLidarProcessHandler(uint32_t handle) {
+  auto iter = sdk_process_handlers_.find(handle);
+  if (iter != sdk_process_handlers_.end()) {
+    return iter->second;
+  }
+
+  uint32_t id = 0;
+  GetLidarId(kLivoxLidarType, handle, id);
+  int32_t cpu_id = -1;
+  std::unique_ptr<LidarPubHandler> process_handler(new LidarPubHandler());
+  process_handler->SetPointsPerFrame(points_per_frame_);
+  process_handler->SetFusedPointCloud2(fused_pointcloud2_);
+  {
+    std::unique_lock<std::mutex> lock(packet_mutex_);
+    if (lidar_extrinsics_.find(id) != lidar_extrinsics_.end()) {
+      process_handler->SetLidarsExtParam(lidar_extrinsics_[id]);
+    }
+    if (lidar_decode_cpus_.find(id) != lidar_decode_cpus_.end()) {
+      cpu_id = lidar_decode_cpus_[id];
+    }
+  }
+
+  // published before the worker starts, CheckTimer looks the handler up by id
+  LidarPubHandler* handler = process_handler.get();
+  {
+    std::lock_guard<std::mutex> lock(frame_mutex_);
+    lidar_process_handlers_[id] = std::move(process_handler);
+  }
+  handler->StartProcessThread(packet_queue_size_, cpu_id, [this, id]() {
+    std::lock_guard<std::mutex> lock(frame_mutex_);
+    CheckTimer(id);
+  });
+  sdk_process_handlers_[handle] = handler;
+  return handler;
+}
+
 bool PubHandler::GetLidarId(LidarProtoType lidar_type, uint32_t handle, uint32_t& id) {
   if (lidar_type == kLivoxLidarType) {
     id = handle;
@@ -276,30 +367,95 @@ uint64_t PubHandler::GetEthPacketTimestamp(uint8_t timestamp_type, uint8_t* time
 
 /*******************************/
 /*  LidarPubHandler Definitions*/
-LidarPubHandler::LidarPubHandler() : is_set_extrinsic_params_(false) {}
+LidarPubHandler::LidarPubHandler() : is_set_extrinsic_params_(false) {
+  UpdatePointTransforms();
+}
 
-uint64_t LidarPubHandler::GetLidarBaseTime() {
-  if (points_clouds_.empty()) {
-    return 0;
+bool LidarPubHandler::StartProcessThread(uint32_t queue_size, int32_t cpu_id,
+                                         PacketProcessedCallback cb) {
+  if (process_thread_) {
+    return false;
+  }
+  packet_queue_.Init(queue_size);
+  packet_processed_cb_ = cb;
+  is_quit_.store(false);
+  process_thread_ = std::make_shared<std::thread>(&LidarPubHandler::ProcessThread, this);
+
+  if (cpu_id >= 0) {
+#ifdef __linux__
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(cpu_id, &cpu_set);
+    int ret = pthread_setaffinity_np(process_thread_->native_handle(), sizeof(cpu_set_t), &cpu_set);
+    if (ret != 0) {
+      printf("Failed to pin decode thread to cpu:%d, ret:%d.\n", cpu_id, ret);
+    }
+#else
+    printf("Pinning decode thread to cpu is not supported on this platform.\n");
+#endif
   }
-  return points_clouds_.at(0).offset_time;
+  return true;
 }
 
-void LidarPubHandler::GetLidarPointClouds(std::vector<PointXyzlt>& points_clouds) {
+void LidarPubHandler::StopProcessThread() {
+  if (!process_thread_) {
+    return;
+  }
+  is_quit_.store(true);
+  packet_queue_.Notify();
+  if (process_thread_->joinable()) {
+    process_thread_->join();
+  }
+  process_thread_ = nullptr;
+}
+
+void LidarPubHandler::ProcessThread() {
+  while (!is_quit_.load()) {
+    if (!packet_queue_.Wait(500)) {
+      continue;
+    }
+    RawPacket* raw_data = packet_queue_.Front();
+    PointCloudProcess(*raw_data);
+    packet_queue_.Pop();
+    if (packet_processed_cb_) {
+      packet_processed_cb_();
+    }
+  }
+}
+
+uint64_t LidarPubHandler::GetLidarBaseTime() {
+  return base_time_;
+}
+
+uint64_t LidarPubHandler::GetLidarPointClouds(std::vector<uint8_t>& points_clouds) {
   std::lock_guard<std::mutex> lock(mutex_);
+  uint64_t base_time = base_time_;
   points_clouds.swap(points_clouds_);
+  // the caller hands back the previous frame buffer, keep its capacity for the next frame
+  points_clouds_.clear();
+  if (points_clouds_.capacity() < points_per_frame_ * kPointRecordSize) {
+    points_clouds_.reserve(points_per_frame_ * kPointRecordSize);
+  }
+  base_time_ = 0;
+  recent_time_ = 0;
+  return base_time;
 }
 
-uint64_t LidarPubHandler::GetRecentTimeStamp() {
-  if (points_clouds_.empty()) {
-    return 0;
+void LidarPubHandler::SetPointsPerFrame(uint32_t points_per_frame) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  points_per_frame_ = points_per_frame;
+  if (points_clouds_.capacity() < points_per_frame_ * kPointRecordSize) {
+    points_clouds_.reserve(points_per_frame_ * kPointRecordSize);
   }
-  return points_clouds_.back().offset_time;
+}
+
+uint64_t LidarPubHandler::GetRecentTimeStamp() {
+  return recent_time_;
 }
 
 uint32_t LidarPubHandler::GetLidarPointCloudsSize() {
   std::lock_guard<std::mutex> lock(mutex_);
-  return points_clouds_.size();
+  return points_clouds_.size() / kPointRecordSize;
 }
 
 //convert to standard format and extrinsic compensate
@@ -316,37 +472,66 @@ void LidarPubHandler::PointCloudProcess(RawPacket & pkt) {
 }
 
 void LidarPubHandler::LivoxLidarPointCloudProcess(RawPacket & pkt) {
-  switch (pkt.data_type) {
-    case kLivoxLidarCartesianCoordinateHighData:
-      ProcessCartesianHighPoint(pkt);
-      break;
-    case kLivoxLidarCartesianCoordinateLowData:
-      ProcessCartesianLowPoint(pkt);
-      break;
-    case kLivoxLidarSphericalCoordinateData:
-      ProcessSphericalPoint(pkt);
-      break;
-    default:
-      std::cout << "unknown data type: " << static_cast<int>(pkt.data_type)
-                << " !!" << std::endl;
-      break;
+  // extrinsic_enable means the lidar has applied the extrinsic itself
+  const int mode = pkt.extrinsic_enable ? 0 : 1;
+  PointDecodeFunc decode = GetPointDecodeFunc(pkt.data_type, mode == 1, fused_pointcloud2_);
+  if (decode == nullptr) {
+    std::cout << "unknown data type: " << static_cast<int>(pkt.data_type)
+              << " !!" << std::endl;
+    return;
+  }
+
+  // a malformed dot_num must not grow the buffer past the points the packet holds
+  uint32_t point_num = GetDecodablePointNum(pkt);
+  if (point_num == 0) {
+    return;
+  }
+
+  // decode straight into the frame buffer, one lock per packet
+  std::lock_guard<std::mutex> lock(mutex_);
+  size_t offset = points_clouds_.size();
+  points_clouds_.resize(offset + point_num * kPointRecordSize);
+  PointXyzlt* points = reinterpret_cast<PointXyzlt*>(points_clouds_.data() + offset);
+  decode(pkt, point_transforms_[pkt.data_type][mode], points);
+
+  // frame times are tracked here, in fused mode the records hold double timestamps
+  if (offset == 0) {
+    base_time_ = pkt.time_stamp;
+  }
+  recent_time_ = pkt.time_stamp + (point_num - 1) * pkt.point_interval;
+}
+
+void LidarPubHandler::UpdatePointTransforms() {
+  // cartesian high and spherical depth are in mm, cartesian low in cm
+  const float unit_scales[] = {0.0f, 1.0f / 1000.0f, 1.0f / 100.0f, 1.0f / 1000.0f};
+  for (uint8_t data_type = kLivoxLidarCartesianCoordinateHighData;
+       data_type <= kLivoxLidarSphericalCoordinateData; data_type++) {
+    MakePointTransform(nullptr, unit_scales[data_type], point_transforms_[data_type][0]);
+    MakePointTransform(&extrinsic_, unit_scales[data_type], point_transforms_[data_type][1]);
   }
 }
 
 void LidarPubHandler::SetLidarsExtParam(LidarExtParameter lidar_param) {
+  // ExtParameter is in mm, the decode transform takes the translation in meter
+  SetExtrinsic(lidar_param.param.roll, lidar_param.param.pitch, lidar_param.param.yaw,
+               lidar_param.param.x / 1000.0f, lidar_param.param.y / 1000.0f,
+               lidar_param.param.z / 1000.0f);
+}
+
+void LidarPubHandler::SetExtrinsic(float roll, float pitch, float yaw, float x, float y, float z) {
   if (is_set_extrinsic_params_) {
     return;
   }
-  extrinsic_.trans[0] = lidar_param.param.x;
-  extrinsic_.trans[1] = lidar_param.param.y;
-  extrinsic_.trans[2] = lidar_param.param.z;
+  extrinsic_.trans[0] = x;
+  extrinsic_.trans[1] = y;
+  extrinsic_.trans[2] = z;
 
-  double cos_roll = cos(static_cast<double>(lidar_param.param.roll * PI / 180.0));
-  double cos_pitch = cos(static_cast<double>(lidar_param.param.pitch * PI / 180.0));
-  double cos_yaw = cos(static_cast<double>(lidar_param.param.yaw * PI / 180.0));
-  double sin_roll = sin(static_cast<double>(lidar_param.param.roll * PI / 180.0));
-  double sin_pitch = sin(static_cast<double>(lidar_param.param.pitch * PI / 180.0));
-  double sin_yaw = sin(static_cast<double>(lidar_param.param.yaw * PI / 180.0));
+  double cos_roll = cos(static_cast<double>(roll * PI / 180.0));
+  double cos_pitch = cos(static_cast<double>(pitch * PI / 180.0));
+  double cos_yaw = cos(static_cast<double>(yaw * PI / 180.0));
+  double sin_roll = sin(static_cast<double>(roll * PI / 180.0));
+  double sin_pitch = sin(static_cast<double>(pitch * PI / 180.0));
+  double sin_yaw = sin(static_cast<double>(yaw * PI / 180.0));
 
   extrinsic_.rotation[0][0] = cos_pitch * cos_yaw;
   extrinsic_.rotation[0][1] = sin_roll * sin_pitch * cos_yaw - cos_roll * sin_yaw;
@@ -360,98 +545,8 @@ void LidarPubHandler::SetLidarsExtParam(LidarExtParameter lidar_param) {
   extrinsic_.rotation[2][1] = sin_roll * cos_pitch;
   extrinsic_.rotation[2][2] = cos_roll * cos_pitch;
 
+  UpdatePointTransforms();
   is_set_extrinsic_params_ = true;
 }
 
-void LidarPubHandler::ProcessCartesianHighPoint(RawPacket & pkt) {
-  LivoxLidarCartesianHighRawPoint* raw = (LivoxLidarCartesianHighRawPoint*)pkt.raw_data.data();
-  PointXyzlt point = {};
-  for (uint32_t i = 0; i < pkt.point_num; i++) {
-    if (pkt.extrinsic_enable) {
-      point.x = raw[i].x / 1000.0;
-      point.y = raw[i].y / 1000.0;
-      point.z = raw[i].z / 1000.0;
-    } else {
-      point.x = (raw[i].x * extrinsic_.rotation[0][0] +
-                raw[i].y * extrinsic_.rotation[0][1] +
-                raw[i].z * extrinsic_.rotation[0][2] + extrinsic_.trans[0]) / 1000.0;
-      point.y = (raw[i].x* extrinsic_.rotation[1][0] +
-                raw[i].y * extrinsic_.rotation[1][1] +
-                raw[i].z * extrinsic_.rotation[1][2] + extrinsic_.trans[1]) / 1000.0;
-      point.z = (raw[i].x * extrinsic_.rotation[2][0] +
-                raw[i].y * extrinsic_.rotation[2][1] +
-                raw[i].z * extrinsic_.rotation[2][2] + extrinsic_.trans[2]) / 1000.0;
-    }
-    point.intensity = raw[i].reflectivity;
-    point.line = i % pkt.line_num;
-    point.tag = raw[i].tag;
-    point.offset_time = pkt.time_stamp + i * pkt.point_interval;
-    std::lock_guard<std::mutex> lock(mutex_);
-    points_clouds_.push_back(point);
-  }
-}
-
-void LidarPubHandler::ProcessCartesianLowPoint(RawPacket & pkt) {
-  LivoxLidarCartesianLowRawPoint* raw = (LivoxLidarCartesianLowRawPoint*)pkt.raw_data.data();
-  PointXyzlt point = {};
-  for (uint32_t i = 0; i < pkt.point_num; i++) {
-    if (pkt.extrinsic_enable) {
-      point.x = raw[i].x / 100.0;
-      point.y = raw[i].y / 100.0;
-      point.z = raw[i].z / 100.0;
-    } else {
-      point.x = (raw[i].x * extrinsic_.rotation[0][0] +
-                raw[i].y * extrinsic_.rotation[0][1] +
-                raw[i].z * extrinsic_.rotation[0][2] + extrinsic_.trans[0]) / 100.0;
-      point.y = (raw[i].x* extrinsic_.rotation[1][0] +
-                raw[i].y * extrinsic_.rotation[1][1] +
-                raw[i].z * extrinsic_.rotation[1][2] + extrinsic_.trans[1]) / 100.0;
-      point.z = (raw[i].x * extrinsic_.rotation[2][0] +
-                raw[i].y * extrinsic_.rotation[2][1] +
-                raw[i].z * extrinsic_.rotation[2][2] + extrinsic_.trans[2]) / 100.0;
-    }
-    point.intensity = raw[i].reflectivity;
-    point.line = i % pkt.line_num;
-    point.tag = raw[i].tag;
-    point.offset_time = pkt.time_stamp + i * pkt.point_interval;
-    std::lock_guard<std::mutex> lock(mutex_);
-    points_clouds_.push_back(point);
-  }
-}
-
-void LidarPubHandler::ProcessSphericalPoint(RawPacket& pkt) {
-  LivoxLidarSpherPoint* raw = (LivoxLidarSpherPoint*)pkt.raw_data.data();
-  PointXyzlt point = {};
-  for (uint32_t i = 0; i < pkt.point_num; i++) {
-    double radius = raw[i].depth / 1000.0;
-    double theta = raw[i].theta / 100.0 / 180 * PI;
-    double phi = raw[i].phi / 100.0 / 180 * PI;
-    double src_x = radius * sin(theta) * cos(phi);
-    double src_y = radius * sin(theta) * sin(phi);
-    double src_z = radius * cos(theta);
-    if (pkt.extrinsic_enable) {
-      point.x = src_x;
-      point.y = src_y;
-      point.z = src_z;
-    } else {
-      point.x = src_x * extrinsic_.rotation[0][0] +
-                src_y * extrinsic_.rotation[0][1] +
-                src_z * extrinsic_.rotation[0][2] + (extrinsic_.trans[0] / 1000.0);
-      point.y = src_x * extrinsic_.rotation[1][0] +
-                src_y * extrinsic_.rotation[1][1] +
-                src_z * extrinsic_.rotation[1][2] + (extrinsic_.trans[1] / 1000.0);
-      point.z = src_x * extrinsic_.rotation[2][0] +
-                src_y * extrinsic_.rotation[2][1] +
-                src_z * extrinsic_.rotation[2][2] + (extrinsic_.trans[2] / 1000.0);
-    }
-
-    point.intensity = raw[i].reflectivity;
-    point.line = i % pkt.line_num;
-    point.tag = raw[i].tag;
-    point.offset_time = pkt.time_stamp + i * pkt.point_interval;
-    std::lock_guard<std::mutex> lock(mutex_);
-    points_clouds_.push_back(point);
-  }
-}
-
 } // namespace livox_ros
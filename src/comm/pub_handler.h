@@ -27,8 +27,6 @@
 
 #include <atomic>
 #include <cstring>
-#include <condition_variable> // std::condition_variable
-#include <deque>
 #include <functional>
 #include <map>
 #include <memory>
@@ -38,17 +36,32 @@
 #include "livox_lidar_def.h"
 #include "livox_lidar_api.h"
 #include "comm/comm.h"
+#include "comm/raw_packet_queue.h"
+#include "comm/packet_recorder.h"
+#include "comm/point_decoder.h"
 
 namespace livox_ros {
 
 class LidarPubHandler {
  public:
+  using PacketProcessedCallback = std::function<void()>;
+
   LidarPubHandler();
-  ~ LidarPubHandler() {}
+  ~ LidarPubHandler() { StopProcessThread(); }
+
+  // per lidar decode worker, used when the raw data process is sharded by lidar
+  bool StartProcessThread(uint32_t queue_size, int32_t cpu_id, PacketProcessedCallback cb);
+  void StopProcessThread();
+  RawPacketQueue* GetPacketQueue() { return &packet_queue_; }
 
   void PointCloudProcess(RawPacket& pkt);
   void SetLidarsExtParam(LidarExtParameter param);
-  void GetLidarPointClouds(std::vector<PointXyzlt>& points_clouds);
+  /** roll, pitch and yaw in degree, x, y and z in meter, ignored once an extrinsic is set */
+  void SetExtrinsic(float roll, float pitch, float yaw, float x, float y, float z);
+  /** swaps the decoded frame out, returns the time of its first point */
+  uint64_t GetLidarPointClouds(std::vector<uint8_t>& points_clouds);
+  void SetPointsPerFrame(uint32_t points_per_frame);
+  void SetFusedPointCloud2(bool enable) { fused_pointcloud2_ = enable; }
 
   uint64_t GetRecentTimeStamp();
   uint32_t GetLidarPointCloudsSize();
@@ -56,10 +69,12 @@ class LidarPubHandler {
 
  private:
   void LivoxLidarPointCloudProcess(RawPacket & pkt);
-  void ProcessCartesianHighPoint(RawPacket & pkt);
-  void ProcessCartesianLowPoint(RawPacket & pkt);
-  void ProcessSphericalPoint(RawPacket & pkt);
-  std::vector<PointXyzlt> points_clouds_;
+  void UpdatePointTransforms();
+  void ProcessThread();
+  std::vector<uint8_t> points_clouds_;   /**< PointXyzlt records, LivoxPointXyzrtlt when fused */
+  uint64_t base_time_ = 0;
+  uint64_t recent_time_ = 0;
+  bool fused_pointcloud2_ = false;
   ExtParameterDetailed extrinsic_ = {
     {0, 0, 0},
     {
@@ -68,8 +83,16 @@ class LidarPubHandler {
       {0, 0, 1}
     }
   };
+  // per raw data type, [1] is extrinsic_ with the raw unit folded in, [0] only converts to meter
+  PointTransform point_transforms_[kLivoxLidarSphericalCoordinateData + 1][2];
+  uint32_t points_per_frame_ = 0;
   std::mutex mutex_;
   std::atomic_bool is_set_extrinsic_params_;
+
+  RawPacketQueue packet_queue_;
+  std::shared_ptr<std::thread> process_thread_;
+  std::atomic<bool> is_quit_{false};
+  PacketProcessedCallback packet_processed_cb_;
 };
   
 class PubHandler {
@@ -86,18 +109,31 @@ class PubHandler {
   void RequestExit();
   void Init();
   void SetPointCloudConfig(const double publish_freq);
+  void SetPacketQueueSize(const uint32_t queue_size) { packet_queue_size_ = queue_size; }
+  void SetDecodeThreadPerLidar(const bool enable) { decode_thread_per_lidar_ = enable; }
+  /** decode into PointCloud2 (LivoxPointXyzrtlt) records, only when PointCloud2 is the sole output */
+  void SetFusedPointCloud2(const bool enable) { fused_pointcloud2_ = enable; }
+  void SetLidarDecodeCpu(const uint32_t handle, const int32_t cpu_id);
   void SetPointCloudsCallback(PointCloudsCallback cb, void* client_data);
   void AddLidarsExtParam(LidarExtParameter& extrinsic_params);
   void ClearAllLidarsExtrinsicParams();
   void SetImuDataCallback(ImuDataCallback cb, void* client_data);
+  /** capture every packet the SDK delivers to path, call before SetPointCloudsCallback */
+  bool StartPacketRecord(const std::string& path) { return packet_recorder_.Start(path); }
+  /** false when packets come from InjectPacket instead of the SDK, call before SetPointCloudsCallback */
+  void SetSdkPacketSource(const bool enable) { sdk_packet_source_ = enable; }
+  /** feeds a packet through the same entry point the SDK observer uses, from a single thread */
+  void InjectPacket(uint32_t handle, const uint8_t dev_type, LivoxLidarEthernetPacket *data) {
+    OnLivoxLidarPointCloudCallback(handle, dev_type, data, this);
+  }
 
  private:
   //thread to process raw data
   void RawDataProcess();
+  LidarPubHandler* GetLidarProcessHandler(uint32_t handle);
   std::atomic<bool> is_quit_{false};
   std::shared_ptr<std::thread> point_process_thread_;
   std::mutex packet_mutex_;
-  std::condition_variable packet_condition_;
 
   //publish callback
   void CheckTimer(uint32_t id);
@@ -116,19 +152,30 @@ class PubHandler {
 
   PointFrame frame_;
 
-  std::deque<RawPacket> raw_packet_queue_;
+  RawPacketQueue raw_packet_queue_;
+  uint32_t packet_queue_size_ = kDefaultRawPacketQueueSize;
+
+  // one decode worker per lidar, frame assembly is serialized by frame_mutex_
+  bool decode_thread_per_lidar_ = false;
+  std::mutex frame_mutex_;
+  std::map<uint32_t, LidarPubHandler*> sdk_process_handlers_; /**< only touched by the SDK thread */
+  std::map<uint32_t, int32_t> lidar_decode_cpus_;
 
   //pub config
   uint64_t publish_interval_ = 100000000; //100 ms
   uint64_t publish_interval_tolerance_ = 100000000; //100 ms
   uint64_t publish_interval_ms_ = 100; //100 ms
+  uint32_t points_per_frame_ = 0;
+  bool fused_pointcloud2_ = false;
   TimePoint last_pub_time_;
 
   std::map<uint32_t, std::unique_ptr<LidarPubHandler>> lidar_process_handlers_;
-  std::map<uint32_t, std::vector<PointXyzlt>> points_;
+  std::map<uint32_t, std::vector<uint8_t>> points_;
   std::map<uint32_t, LidarExtParameter> lidar_extrinsics_;
   static std::atomic<bool> is_timestamp_sync_;
   uint16_t lidar_listen_id_ = 0;
+  bool sdk_packet_source_ = true;
+  PacketRecorder packet_recorder_;
 };
 
 PubHandler &pub_handler();
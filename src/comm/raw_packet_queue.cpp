@@ -0,0 +1,124 @@
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2022 Livox. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include "raw_packet_queue.h"
+
+#include <stdio.h>
+#include <chrono>
+
+#include "comm/ldq.h"
+
+namespace livox_ros {
+
+bool RawPacketQueue::Init(uint32_t queue_size) {
+  if (queue_size < kMinEthPacketQueueSize) {
+    queue_size = kMinEthPacketQueueSize;
+  } else if (queue_size > kMaxEthPacketQueueSize) {
+    queue_size = kMaxEthPacketQueueSize;
+  }
+  if (!IsPowerOf2(queue_size)) {
+    queue_size = RoundupPowerOf2(queue_size);
+  }
+
+  DeInit();
+  slots_ = new RawPacket[queue_size];
+  size_ = queue_size;
+  mask_ = queue_size - 1;
+  rd_idx_.store(0);
+  wr_idx_.store(0);
+  dropped_.store(0);
+  printf("Init raw packet queue, size:%u.\n", queue_size);
+  return true;
+}
+
+void RawPacketQueue::DeInit() {
+  if (slots_) {
+    delete[] slots_;
+    slots_ = nullptr;
+  }
+  size_ = 0;
+  mask_ = 0;
+}
+
+RawPacket* RawPacketQueue::PushBegin() {
+  uint32_t wr_idx = wr_idx_.load(std::memory_order_relaxed);
+  if (slots_ == nullptr || (wr_idx - rd_idx_.load(std::memory_order_acquire)) >= size_) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+  }
+  return &slots_[wr_idx & mask_];
+}
+
+void RawPacketQueue::PushEnd() {
+  wr_idx_.store(wr_idx_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+
+  // pairs with the fence in Wait, either the consumer sees the new packet or we see it sleeping
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (waiting_.load(std::memory_order_relaxed)) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    cv_.notify_one();
+  }
+}
+
+RawPacket* RawPacketQueue::Front() {
+  uint32_t rd_idx = rd_idx_.load(std::memory_order_relaxed);
+  if (rd_idx == wr_idx_.load(std::memory_order_acquire)) {
+    return nullptr;
+  }
+  return &slots_[rd_idx & mask_];
+}
+
+void RawPacketQueue::Pop() {
+  rd_idx_.store(rd_idx_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+bool RawPacketQueue::Wait(uint32_t timeout_ms) {
+  if (!Empty()) {
+    return true;
+  }
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  waiting_.store(true, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (Empty()) {
+    cv_.wait_for(lock, std::chrono::milliseconds(timeout_ms));
+  }
+  waiting_.store(false, std::memory_order_relaxed);
+  return !Empty();
+}
+
+void RawPacketQueue::Notify() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  cv_.notify_all();
+}
+
+bool RawPacketQueue::Empty() {
+  return rd_idx_.load(std::memory_order_acquire) == wr_idx_.load(std::memory_order_acquire);
+}
+
+uint32_t RawPacketQueue::Size() {
+  return wr_idx_.load(std::memory_order_acquire) - rd_idx_.load(std::memory_order_acquire);
+}
+
+} // namespace livox_ros
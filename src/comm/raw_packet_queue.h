@@ -0,0 +1,90 @@
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2022 Livox. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#ifndef LIVOX_ROS_DRIVER_RAW_PACKET_QUEUE_H_
+#define LIVOX_ROS_DRIVER_RAW_PACKET_QUEUE_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+#include "comm/comm.h"
+
+namespace livox_ros {
+
+/**
+ * Bounded single-producer/single-consumer ring of preallocated RawPacket slots.
+ * The producer (the SDK receive thread) fills a slot in place between PushBegin
+ * and PushEnd, the consumer reads it in place between Front and Pop, so no packet
+ * is allocated or copied on the way from the SDK to the decoder.
+ */
+class RawPacketQueue {
+ public:
+  RawPacketQueue() {}
+  ~RawPacketQueue() { DeInit(); }
+  RawPacketQueue(const RawPacketQueue &) = delete;
+  RawPacketQueue &operator=(const RawPacketQueue &) = delete;
+
+  /** queue_size is clamped to [kMinEthPacketQueueSize, kMaxEthPacketQueueSize] and rounded up to 2^n */
+  bool Init(uint32_t queue_size);
+  void DeInit();
+
+  /** producer side, returns nullptr and counts a dropped packet when the queue is full */
+  RawPacket* PushBegin();
+  void PushEnd();
+
+  /** consumer side, returns nullptr when the queue is empty */
+  RawPacket* Front();
+  void Pop();
+
+  /** block the consumer until a packet is available or timeout_ms expires */
+  bool Wait(uint32_t timeout_ms);
+  void Notify();
+
+  bool Empty();
+  uint32_t Size();
+  uint32_t Capacity() { return size_; }
+  uint64_t GetDropCount() { return dropped_.load(std::memory_order_relaxed); }
+
+ private:
+  RawPacket* slots_ = nullptr;
+  uint32_t size_ = 0;
+  uint32_t mask_ = 0;
+
+  // rd/wr indexes live on separate cache lines so the two threads do not share them
+  std::atomic<uint32_t> rd_idx_{0};
+  uint8_t rd_pad_[kCacheLineSize - sizeof(std::atomic<uint32_t>)];
+  std::atomic<uint32_t> wr_idx_{0};
+  uint8_t wr_pad_[kCacheLineSize - sizeof(std::atomic<uint32_t>)];
+
+  std::atomic<uint64_t> dropped_{0};
+  std::atomic<bool> waiting_{false};
+  std::mutex mutex_;
+  std::condition_variable cv_;
+};
+
+} // namespace livox_ros
+
+#endif // LIVOX_ROS_DRIVER_RAW_PACKET_QUEUE_H_
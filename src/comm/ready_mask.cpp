@@ -0,0 +1,89 @@
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2022 Livox. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+
+#include "ready_mask.h"
+
+#include <chrono>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+namespace livox_ros {
+
+void ReadyMask::Set(uint8_t index) {
+  uint32_t bit = static_cast<uint32_t>(1) << index;
+  uint32_t old_bits = bits_.fetch_or(bit, std::memory_order_acq_rel);
+  // the consumer only sleeps on an empty mask, later producers need not wake it again
+  if (old_bits == 0) {
+    Wake();
+  }
+}
+
+uint32_t ReadyMask::Wait(uint32_t timeout_ms) {
+  uint32_t bits = bits_.exchange(0, std::memory_order_acq_rel);
+  if (bits != 0) {
+    return bits;
+  }
+
+#ifdef __linux__
+  // sleeps only if the mask is still 0, a Set in between makes the syscall return at once
+  struct timespec timeout;
+  timeout.tv_sec = timeout_ms / 1000;
+  timeout.tv_nsec = (timeout_ms % 1000) * 1000000L;
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(&bits_), FUTEX_WAIT_PRIVATE, 0, &timeout, nullptr, 0);
+#else
+  std::unique_lock<std::mutex> lock(mutex_);
+  waiting_.store(true, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (bits_.load(std::memory_order_relaxed) == 0) {
+    cv_.wait_for(lock, std::chrono::milliseconds(timeout_ms));
+  }
+  waiting_.store(false, std::memory_order_relaxed);
+#endif
+  return bits_.exchange(0, std::memory_order_acq_rel);
+}
+
+void ReadyMask::Notify() {
+  Wake();
+}
+
+void ReadyMask::Wake() {
+#ifdef __linux__
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(&bits_), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+#else
+  // pairs with the fence in Wait, either the consumer sees the bit or we see it sleeping
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (waiting_.load(std::memory_order_relaxed)) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    cv_.notify_one();
+  }
+#endif
+}
+
+} // namespace livox_ros
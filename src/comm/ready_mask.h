@@ -22,30 +22,50 @@
 // SOFTWARE.
 //
 
-#ifndef LIVOX_ROS_DRIVER_SEMAPHORE_H_
-#define LIVOX_ROS_DRIVER_SEMAPHORE_H_
 
-#include <mutex>
+#ifndef LIVOX_ROS_DRIVER_READY_MASK_H_
+#define LIVOX_ROS_DRIVER_READY_MASK_H_
+
+#include <atomic>
 #include <condition_variable>
+#include <cstdint>
+#include <mutex>
 
 namespace livox_ros {
 
-class Semaphore {
+/**
+ * One readiness bit per lidar index, set by the producers and taken as a whole by
+ * the single consumer. The consumer sleeps on a futex (a condition variable where
+ * futex is not available) only while no bit is set, and a producer issues a wakeup
+ * only when it sets the first bit, so the consumer wakes once per batch and visits
+ * just the lidars whose bits it took.
+ */
+class ReadyMask {
  public:
-  explicit Semaphore(int count = 0) : count_(count) {
-  }
-  void Signal();
-  void Wait();
-  int GetCount() {
-    return count_;
-  }
+  ReadyMask() {}
+  ReadyMask(const ReadyMask &) = delete;
+  ReadyMask &operator=(const ReadyMask &) = delete;
+
+  /** producer side, index must be < 32 */
+  void Set(uint8_t index);
+
+  /** consumer side, returns and clears the set bits, 0 on timeout or Notify */
+  uint32_t Wait(uint32_t timeout_ms);
+
+  /** wake a sleeping consumer without setting a bit, e.g. on exit */
+  void Notify();
 
  private:
+  void Wake();
+
+  std::atomic<uint32_t> bits_{0};
+#ifndef __linux__
+  std::atomic<bool> waiting_{false};
   std::mutex mutex_;
   std::condition_variable cv_;
-  volatile int count_;
+#endif
 };
 
 } // namespace livox_ros
 
-#endif // LIVOX_ROS_DRIVER_SEMAPHORE_H_
+#endif // LIVOX_ROS_DRIVER_READY_MASK_H_
@@ -27,6 +27,8 @@
 #include "comm/comm.h"
 
 #include <inttypes.h>
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <iomanip>
 #include <math.h>
@@ -53,12 +55,16 @@ Lddc::Lddc(int format, int multi_topic, int data_src, int output_type,
       enable_imu_bag_(imu_bag) {
   publish_period_ns_ = kNsPerSecond / publish_frq_;
   lds_ = nullptr;
+  pointcloud2_layout_ = GetPointCloud2Layout(kPointCloud2LayoutXyzrtlt);
+  imu_direct_publish_ = false;
+  SetXferFormatMask(0);
   memset(private_pub_, 0, sizeof(private_pub_));
   memset(private_imu_pub_, 0, sizeof(private_imu_pub_));
-  global_pub_ = nullptr;
+  memset(global_pub_, 0, sizeof(global_pub_));
   global_imu_pub_ = nullptr;
   cur_node_ = nullptr;
   bag_ = nullptr;
+  memset(custom_msg_seq_, 0, sizeof(custom_msg_seq_));
 }
 #elif defined BUILDING_ROS2
 Lddc::Lddc(int format, int multi_topic, int data_src, int output_type,
@@ -71,6 +77,11 @@ Lddc::Lddc(int format, int multi_topic, int data_src, int output_type,
       frame_id_(frame_id) {
   publish_period_ns_ = kNsPerSecond / publish_frq_;
   lds_ = nullptr;
+  pointcloud2_layout_ = GetPointCloud2Layout(kPointCloud2LayoutXyzrtlt);
+  imu_direct_publish_ = false;
+  SetXferFormatMask(0);
+  use_loaned_messages_ = false;
+  use_intra_process_comms_ = false;
 #if 0
   bag_ = nullptr;
 #endif
@@ -79,8 +90,10 @@ Lddc::Lddc(int format, int multi_topic, int data_src, int output_type,
 
 Lddc::~Lddc() {
 #ifdef BUILDING_ROS1
-  if (global_pub_) {
-    delete global_pub_;
+  for (uint32_t i = 0; i < kMaxPointCloudFormats; i++) {
+    if (global_pub_[i]) {
+      delete global_pub_[i];
+    }
   }
 
   if (global_imu_pub_) {
@@ -91,9 +104,11 @@ Lddc::~Lddc() {
   PrepareExit();
 
 #ifdef BUILDING_ROS1
-  for (uint32_t i = 0; i < kMaxSourceLidar; i++) {
-    if (private_pub_[i]) {
-      delete private_pub_[i];
+  for (uint32_t i = 0; i < kMaxPointCloudFormats; i++) {
+    for (uint32_t j = 0; j < kMaxSourceLidar; j++) {
+      if (private_pub_[i][j]) {
+        delete private_pub_[i][j];
+      }
     }
   }
 
@@ -109,6 +124,17 @@ Lddc::~Lddc() {
 int Lddc::RegisterLds(Lds *lds) {
   if (lds_ == nullptr) {
     lds_ = lds;
+    lds_->SetFusedPointCloud2(fused_pointcloud2_);
+    // topics are created when a lidar registers, not on the publish path
+    lds_->SetLidarRegisteredHandler([this](uint8_t index) { RegisterLidarPublishers(index); });
+    if (imu_direct_publish_) {
+      lds_->SetImuDataHandler([this](uint8_t index, const ImuData& imu_data) {
+        if (!lds_->IsRequestExit() &&
+            (kConnectStateSampling == lds_->lidars_[index].connect_state)) {
+          PublishImuSample(index, imu_data);
+        }
+      });
+    }
     return 0;
   } else {
     return -1;
@@ -125,9 +151,14 @@ void Lddc::DistributePointCloudData(void) {
     return;
   }
   
-  lds_->pcd_semaphore_.Wait();
-  for (uint32_t i = 0; i < lds_->lidar_count_; i++) {
-    uint32_t lidar_id = i;
+  // visit only the lidars that pushed since the last wakeup
+  uint32_t ready = lds_->pcd_ready_.Wait(kReadyWaitTimeoutMs);
+  while (ready != 0) {
+    uint32_t lidar_id = __builtin_ctz(ready);
+    ready &= ready - 1;
+    if (lidar_id >= lds_->lidar_count_) {
+      continue;
+    }
     LidarDevice *lidar = &lds_->lidars_[lidar_id];
     LidarDataQueue *p_queue = &lidar->data;
     if ((kConnectStateSampling != lidar->connect_state) || (p_queue == nullptr)) {
@@ -147,9 +178,13 @@ void Lddc::DistributeImuData(void) {
     return;
   }
   
-  lds_->imu_semaphore_.Wait();
-  for (uint32_t i = 0; i < lds_->lidar_count_; i++) {
-    uint32_t lidar_id = i;
+  uint32_t ready = lds_->imu_ready_.Wait(kReadyWaitTimeoutMs);
+  while (ready != 0) {
+    uint32_t lidar_id = __builtin_ctz(ready);
+    ready &= ready - 1;
+    if (lidar_id >= lds_->lidar_count_) {
+      continue;
+    }
     LidarDevice *lidar = &lds_->lidars_[lidar_id];
     LidarImuDataQueue *p_queue = &lidar->imu_data;
     if ((kConnectStateSampling != lidar->connect_state) || (p_queue == nullptr)) {
@@ -165,15 +200,122 @@ void Lddc::PollingLidarPointCloudData(uint8_t index, LidarDevice *lidar) {
     return;
   }
 
-  while (!lds_->IsRequestExit() && !QueueIsEmpty(p_queue)) {
-    if (kPointCloud2Msg == transfer_format_) {
-      PublishPointcloud2(p_queue, index);
-    } else if (kLivoxCustomMsg == transfer_format_) {
-      PublishCustomPointcloud(p_queue, index);
-    } else if (kPclPxyziMsg == transfer_format_) {
-      PublishPclMsg(p_queue, index);
+  if (point_cloud_format_num_ == 0) {
+    return;
+  }
+
+  StoragePacket& pkg = storage_packets_[index];
+  while (!lds_->IsRequestExit() && QueuePop(p_queue, &pkg)) {
+    if (pkg.points.empty()) {
+      printf("Publish point cloud failed, the pkg points is empty.\n");
+      continue;
     }
+
+    // every format is built from the same decoded frame, and only while its topic is consumed
+    for (uint8_t i = 0; i < point_cloud_format_num_; ++i) {
+      uint8_t format = point_cloud_formats_[i];
+      if (!HasSubscribers(index, format)) {
+        CountSkippedFrame(publish_contexts_[index].points_skipped[format], index, "point cloud");
+        continue;
+      }
+      (this->*point_cloud_publishers_[i])(pkg, index);
+    }
+  }
+}
+
+void Lddc::SetXferFormatMask(uint32_t mask) {
+  xfer_format_mask_ = (mask & ((1u << kMaxPointCloudFormats) - 1));
+  if (transfer_format_ < kMaxPointCloudFormats) {
+    xfer_format_mask_ |= (1u << transfer_format_);
+  } else {
+    std::cout << "unsupported xfer format: " << static_cast<int>(transfer_format_) << std::endl;
+  }
+
+  point_cloud_format_num_ = 0;
+  for (uint8_t format = 0; format < kMaxPointCloudFormats; ++format) {
+    if ((xfer_format_mask_ & (1u << format)) == 0) {
+      continue;
+    }
+    point_cloud_formats_[point_cloud_format_num_] = format;
+    point_cloud_publishers_[point_cloud_format_num_] = SelectPointCloudPublisher(format);
+    ++point_cloud_format_num_;
+  }
+
+  UpdateFusedPointCloud2();
+}
+
+void Lddc::SetPointCloud2Layout(uint8_t layout) {
+  pointcloud2_layout_ = GetPointCloud2Layout(layout);
+  if (pointcloud2_layout_ == nullptr) {
+    std::cout << "unsupported pointcloud2 layout: " << static_cast<int>(layout) << std::endl;
+    pointcloud2_layout_ = GetPointCloud2Layout(kPointCloud2LayoutXyzrtlt);
+  }
+  UpdateFusedPointCloud2();
+}
+
+void Lddc::UpdateFusedPointCloud2() {
+  // frames can only be decoded straight into PointCloud2 records when nothing else reads
+  // them and the records are the decoder's XYZRTLT layout
+  fused_pointcloud2_ = (xfer_format_mask_ == (1u << kPointCloud2Msg)) &&
+      (pointcloud2_layout_ == GetPointCloud2Layout(kPointCloud2LayoutXyzrtlt));
+  if (lds_) {
+    lds_->SetFusedPointCloud2(fused_pointcloud2_);
+  }
+}
+
+bool Lddc::HasSubscribers(uint8_t index, uint8_t format) {
+  // no publisher when the lidar never registered
+#ifdef BUILDING_ROS1
+  ros::Publisher *publisher_ptr = publish_contexts_[index].points_pub[format];
+  if ((publisher_ptr == nullptr) || (kOutputToRos != output_type_)) {
+    return publisher_ptr != nullptr;
   }
+  return publisher_ptr->getNumSubscribers() > 0;
+#elif defined BUILDING_ROS2
+  rclcpp::PublisherBase *publisher_ptr = publish_contexts_[index].points_pub[format];
+  if ((publisher_ptr == nullptr) || (kOutputToRos != output_type_)) {
+    return publisher_ptr != nullptr;
+  }
+  return (publisher_ptr->get_subscription_count() +
+      publisher_ptr->get_intra_process_subscription_count()) > 0;
+#endif
+}
+
+bool Lddc::HasImuSubscribers(uint8_t index) {
+#ifdef BUILDING_ROS1
+  ros::Publisher *publisher_ptr = publish_contexts_[index].imu_pub;
+  if ((publisher_ptr == nullptr) || (kOutputToRos != output_type_)) {
+    return publisher_ptr != nullptr;
+  }
+  return publisher_ptr->getNumSubscribers() > 0;
+#elif defined BUILDING_ROS2
+  rclcpp::Publisher<ImuMsg> *publisher_ptr = publish_contexts_[index].imu_pub;
+  if ((publisher_ptr == nullptr) || (kOutputToRos != output_type_)) {
+    return publisher_ptr != nullptr;
+  }
+  return (publisher_ptr->get_subscription_count() +
+      publisher_ptr->get_intra_process_subscription_count()) > 0;
+#endif
+}
+
+void Lddc::CountSkippedFrame(uint64_t& skipped, uint8_t index, const char* topic_type) {
+  ++skipped;
+  if (ShouldLogCount(skipped)) {
+    printf("Lidar[%u] %s topic has no subscriber, skipped frames:%" PRIu64 ".\n", index, topic_type,
+           skipped);
+  }
+}
+
+Lddc::PublishPointCloudFunc Lddc::SelectPointCloudPublisher(uint8_t format) {
+  if (kPointCloud2Msg == format) {
+    return &Lddc::PublishPointcloud2;
+  } else if (kLivoxCustomMsg == format) {
+    return &Lddc::PublishCustomPointcloud;
+  } else if (kPclPxyziMsg == format) {
+    return &Lddc::PublishPclMsg;
+  }
+  std::cout << "unsupported xfer format: " << static_cast<int>(format) << std::endl;
+  return nullptr;
 }
 
 void Lddc::PollingLidarImuData(uint8_t index, LidarDevice *lidar) {
@@ -198,40 +340,40 @@ void Lddc::PrepareExit(void) {
   }
 }
 
-void Lddc::PublishPointcloud2(LidarDataQueue *queue, uint8_t index) {
-  while(!QueueIsEmpty(queue)) {
-    StoragePacket pkg;
-    QueuePop(queue, &pkg);
-    if (pkg.points.empty()) {
-      printf("Publish point cloud2 failed, the pkg points is empty.\n");
-      continue;
-    }
+void Lddc::PublishPointcloud2(StoragePacket& pkg, uint8_t index) {
+#ifdef BUILDING_ROS2
+  if (PublishByMove()) {
+    PublishLoanedPointcloud2(pkg, index);
+    return;
+  }
+#endif
 
-    PointCloud2 cloud;
-    uint64_t timestamp = 0;
-    InitPointcloud2Msg(pkg, cloud, timestamp);
-    PublishPointcloud2Data(index, timestamp, cloud);
+  PointCloud2& cloud = pointcloud2_msgs_[index];
+  uint64_t timestamp = 0;
+  InitPointcloud2Msg(pkg, cloud, timestamp);
+  PublishPointcloud2Data(index, timestamp, cloud);
+  if (fused_pointcloud2_) {
+    // the message has been serialized, give the frame buffer back to the queue pool
+    pkg.points.swap(cloud.data);
   }
 }
 
-void Lddc::PublishCustomPointcloud(LidarDataQueue *queue, uint8_t index) {
-  while(!QueueIsEmpty(queue)) {
-    StoragePacket pkg;
-    QueuePop(queue, &pkg);
-    if (pkg.points.empty()) {
-      printf("Publish custom point cloud failed, the pkg points is empty.\n");
-      continue;
-    }
-
-    CustomMsg livox_msg;
-    InitCustomMsg(livox_msg, pkg, index);
-    FillPointsToCustomMsg(livox_msg, pkg);
-    PublishCustomPointData(livox_msg, index);
+void Lddc::PublishCustomPointcloud(StoragePacket& pkg, uint8_t index) {
+#ifdef BUILDING_ROS2
+  if (PublishByMove()) {
+    PublishLoanedCustomPointcloud(pkg, index);
+    return;
   }
+#endif
+
+  CustomMsg& livox_msg = custom_msgs_[index];
+  InitCustomMsg(livox_msg, pkg, index);
+  FillPointsToCustomMsg(livox_msg, pkg);
+  PublishCustomPointData(livox_msg, index);
 }
 
 /* for pcl::pxyzi */
-void Lddc::PublishPclMsg(LidarDataQueue *queue, uint8_t index) {
+void Lddc::PublishPclMsg(StoragePacket& pkg, uint8_t index) {
 #ifdef BUILDING_ROS2
   static bool first_log = true;
   if (first_log) {
@@ -242,70 +384,39 @@ void Lddc::PublishPclMsg(LidarDataQueue *queue, uint8_t index) {
   first_log = false;
   return;
 #endif
-  while(!QueueIsEmpty(queue)) {
-    StoragePacket pkg;
-    QueuePop(queue, &pkg);
-    if (pkg.points.empty()) {
-      printf("Publish point cloud failed, the pkg points is empty.\n");
-      continue;
-    }
-
-    PointCloud cloud;
-    uint64_t timestamp = 0;
-    InitPclMsg(pkg, cloud, timestamp);
-    FillPointsToPclMsg(pkg, cloud);
-    PublishPclData(index, timestamp, cloud);
-  }
-  return;
+  PointCloud cloud;
+  uint64_t timestamp = 0;
+  InitPclMsg(pkg, cloud, timestamp);
+  FillPointsToPclMsg(pkg, cloud);
+  PublishPclData(index, timestamp, cloud);
 }
 
 void Lddc::InitPointcloud2MsgHeader(PointCloud2& cloud) {
   cloud.header.frame_id.assign(frame_id_);
   cloud.height = 1;
   cloud.width = 0;
-  cloud.fields.resize(7);
-  cloud.fields[0].offset = 0;
-  cloud.fields[0].name = "x";
-  cloud.fields[0].count = 1;
-  cloud.fields[0].datatype = PointField::FLOAT32;
-  cloud.fields[1].offset = 4;
-  cloud.fields[1].name = "y";
-  cloud.fields[1].count = 1;
-  cloud.fields[1].datatype = PointField::FLOAT32;
-  cloud.fields[2].offset = 8;
-  cloud.fields[2].name = "z";
-  cloud.fields[2].count = 1;
-  cloud.fields[2].datatype = PointField::FLOAT32;
-  cloud.fields[3].offset = 12;
-  cloud.fields[3].name = "intensity";
-  cloud.fields[3].count = 1;
-  cloud.fields[3].datatype = PointField::FLOAT32;
-  cloud.fields[4].offset = 16;
-  cloud.fields[4].name = "tag";
-  cloud.fields[4].count = 1;
-  cloud.fields[4].datatype = PointField::UINT8;
-  cloud.fields[5].offset = 17;
-  cloud.fields[5].name = "line";
-  cloud.fields[5].count = 1;
-  cloud.fields[5].datatype = PointField::UINT8;
-  cloud.fields[6].offset = 18;
-  cloud.fields[6].name = "timestamp";
-  cloud.fields[6].count = 1;
-  cloud.fields[6].datatype = PointField::FLOAT64;
-  cloud.point_step = sizeof(LivoxPointXyzrtlt);
-}
-
-void Lddc::InitPointcloud2Msg(const StoragePacket& pkg, PointCloud2& cloud, uint64_t& timestamp) {
-  InitPointcloud2MsgHeader(cloud);
-
-  cloud.point_step = sizeof(LivoxPointXyzrtlt);
+  cloud.fields.resize(pointcloud2_layout_->field_num);
+  for (uint32_t i = 0; i < pointcloud2_layout_->field_num; ++i) {
+    const PointCloud2FieldDesc& field = pointcloud2_layout_->fields[i];
+    cloud.fields[i].offset = field.offset;
+    cloud.fields[i].name = field.name;
+    cloud.fields[i].count = 1;
+    cloud.fields[i].datatype = field.datatype;
+  }
+  cloud.point_step = pointcloud2_layout_->point_step;
+}
+
+void Lddc::InitPointcloud2Msg(StoragePacket& pkg, PointCloud2& cloud, uint64_t& timestamp) {
+  // the message is reused per lidar, the field layout only has to be built once
+  if (cloud.fields.empty()) {
+    InitPointcloud2MsgHeader(cloud);
+    cloud.is_bigendian = false;
+    cloud.is_dense     = true;
+  }
 
   cloud.width = pkg.points_num;
   cloud.row_step = cloud.width * cloud.point_step;
 
-  cloud.is_bigendian = false;
-  cloud.is_dense     = true;
-
   if (!pkg.points.empty()) {
     timestamp = pkg.base_time;
   }
@@ -316,28 +427,25 @@ void Lddc::InitPointcloud2Msg(const StoragePacket& pkg, PointCloud2& cloud, uint
       cloud.header.stamp = rclcpp::Time(timestamp);
   #endif
 
-  std::vector<LivoxPointXyzrtlt> points;
-  for (size_t i = 0; i < pkg.points_num; ++i) {
-    LivoxPointXyzrtlt point;
-    point.x = pkg.points[i].x;
-    point.y = pkg.points[i].y;
-    point.z = pkg.points[i].z;
-    point.reflectivity = pkg.points[i].intensity;
-    point.tag = pkg.points[i].tag;
-    point.line = pkg.points[i].line;
-    point.timestamp = static_cast<double>(pkg.points[i].offset_time);
-    points.push_back(std::move(point));
+  if (fused_pointcloud2_) {
+    // decoded as LivoxPointXyzrtlt records already, the frame buffer becomes the payload
+    cloud.data.swap(pkg.points);
+    return;
   }
-  cloud.data.resize(pkg.points_num * sizeof(LivoxPointXyzrtlt));
-  memcpy(cloud.data.data(), points.data(), pkg.points_num * sizeof(LivoxPointXyzrtlt));
+
+  // the integer layouts drop the points out of their range, the message shrinks to what is left
+  cloud.data.resize(pkg.points_num * pointcloud2_layout_->point_step);
+  cloud.width = pointcloud2_layout_->fill(reinterpret_cast<const PointXyzlt*>(pkg.points.data()),
+                                          pkg.points_num, pkg.base_time, cloud.data.data());
+  cloud.row_step = cloud.width * cloud.point_step;
+  cloud.data.resize(cloud.row_step);
 }
 
 void Lddc::PublishPointcloud2Data(const uint8_t index, const uint64_t timestamp, const PointCloud2& cloud) {
 #ifdef BUILDING_ROS1
-  PublisherPtr publisher_ptr = Lddc::GetCurrentPublisher(index);
+  PublisherPtr publisher_ptr = publish_contexts_[index].points_pub[kPointCloud2Msg];
 #elif defined BUILDING_ROS2
-  Publisher<PointCloud2>::SharedPtr publisher_ptr =
-    std::dynamic_pointer_cast<Publisher<PointCloud2>>(GetCurrentPublisher(index));
+  Publisher<PointCloud2>* publisher_ptr = publish_contexts_[index].pointcloud2_pub;
 #endif
 
   if (kOutputToRos == output_type_) {
@@ -351,13 +459,63 @@ void Lddc::PublishPointcloud2Data(const uint8_t index, const uint64_t timestamp,
   }
 }
 
+#ifdef BUILDING_ROS2
+namespace {
+std::atomic<Lddc::MovedMessageObserver> moved_message_observer{nullptr};
+} // namespace
+
+void Lddc::SetMovedMessageObserver(MovedMessageObserver observer) {
+  moved_message_observer.store(observer);
+}
+
+void Lddc::NotifyMovedMessage(uint8_t format, const void* msg) {
+  MovedMessageObserver observer = moved_message_observer.load(std::memory_order_relaxed);
+  if (observer != nullptr) {
+    observer(format, msg);
+  }
+}
+
+void Lddc::PublishLoanedPointcloud2(StoragePacket& pkg, uint8_t index) {
+  Publisher<PointCloud2>* publisher_ptr = publish_contexts_[index].pointcloud2_pub;
+  uint64_t timestamp = 0;
+  if (publisher_ptr->can_loan_messages()) {
+    auto loaned_msg = publisher_ptr->borrow_loaned_message();
+    InitPointcloud2Msg(pkg, loaned_msg.get(), timestamp);
+    publisher_ptr->publish(std::move(loaned_msg));
+    return;
+  }
+
+  // intra-process subscribers take this message over without a copy, in fused mode
+  // the frame buffer goes with it and the decoder allocates a new one
+  auto msg = std::make_unique<PointCloud2>();
+  InitPointcloud2Msg(pkg, *msg, timestamp);
+  NotifyMovedMessage(kPointCloud2Msg, msg.get());
+  publisher_ptr->publish(std::move(msg));
+}
+
+void Lddc::PublishLoanedCustomPointcloud(StoragePacket& pkg, uint8_t index) {
+  Publisher<CustomMsg>* publisher_ptr = publish_contexts_[index].custom_pub;
+  if (publisher_ptr->can_loan_messages()) {
+    auto loaned_msg = publisher_ptr->borrow_loaned_message();
+    InitCustomMsg(loaned_msg.get(), pkg, index);
+    FillPointsToCustomMsg(loaned_msg.get(), pkg);
+    publisher_ptr->publish(std::move(loaned_msg));
+    return;
+  }
+
+  auto msg = std::make_unique<CustomMsg>();
+  InitCustomMsg(*msg, pkg, index);
+  FillPointsToCustomMsg(*msg, pkg);
+  NotifyMovedMessage(kLivoxCustomMsg, msg.get());
+  publisher_ptr->publish(std::move(msg));
+}
+#endif
+
 void Lddc::InitCustomMsg(CustomMsg& livox_msg, const StoragePacket& pkg, uint8_t index) {
   livox_msg.header.frame_id.assign(frame_id_);
 
 #ifdef BUILDING_ROS1
-  static uint32_t msg_seq = 0;
-  livox_msg.header.seq = msg_seq;
-  ++msg_seq;
+  livox_msg.header.seq = custom_msg_seq_[index]++;
 #endif
 
   uint64_t timestamp = 0;
@@ -383,9 +541,11 @@ void Lddc::InitCustomMsg(CustomMsg& livox_msg, const StoragePacket& pkg, uint8_t
 
 void Lddc::FillPointsToCustomMsg(CustomMsg& livox_msg, const StoragePacket& pkg) {
   uint32_t points_num = pkg.points_num;
-  const std::vector<PointXyzlt>& points = pkg.points;
+  const PointXyzlt* points = reinterpret_cast<const PointXyzlt*>(pkg.points.data());
+  // sized once, a reused message keeps its capacity
+  livox_msg.points.resize(points_num);
   for (uint32_t i = 0; i < points_num; ++i) {
-    CustomPoint point;
+    CustomPoint& point = livox_msg.points[i];
     point.x = points[i].x;
     point.y = points[i].y;
     point.z = points[i].z;
@@ -393,16 +553,14 @@ void Lddc::FillPointsToCustomMsg(CustomMsg& livox_msg, const StoragePacket& pkg)
     point.tag = points[i].tag;
     point.line = points[i].line;
     point.offset_time = static_cast<uint32_t>(points[i].offset_time - pkg.base_time);
-
-    livox_msg.points.push_back(std::move(point));
   }
 }
 
 void Lddc::PublishCustomPointData(const CustomMsg& livox_msg, const uint8_t index) {
 #ifdef BUILDING_ROS1
-  PublisherPtr publisher_ptr = Lddc::GetCurrentPublisher(index);
+  PublisherPtr publisher_ptr = publish_contexts_[index].points_pub[kLivoxCustomMsg];
 #elif defined BUILDING_ROS2
-  Publisher<CustomMsg>::SharedPtr publisher_ptr = std::dynamic_pointer_cast<Publisher<CustomMsg>>(GetCurrentPublisher(index));
+  Publisher<CustomMsg>* publisher_ptr = publish_contexts_[index].custom_pub;
 #endif
 
   if (kOutputToRos == output_type_) {
@@ -441,7 +599,7 @@ void Lddc::FillPointsToPclMsg(const StoragePacket& pkg, PointCloud& pcl_msg) {
   }
 
   uint32_t points_num = pkg.points_num;
-  const std::vector<PointXyzlt>& points = pkg.points;
+  const PointXyzlt* points = reinterpret_cast<const PointXyzlt*>(pkg.points.data());
   for (uint32_t i = 0; i < points_num; ++i) {
     pcl::PointXYZI point;
     point.x = points[i].x;
@@ -461,7 +619,7 @@ void Lddc::FillPointsToPclMsg(const StoragePacket& pkg, PointCloud& pcl_msg) {
 
 void Lddc::PublishPclData(const uint8_t index, const uint64_t timestamp, const PointCloud& cloud) {
 #ifdef BUILDING_ROS1
-  PublisherPtr publisher_ptr = Lddc::GetCurrentPublisher(index);
+  PublisherPtr publisher_ptr = publish_contexts_[index].points_pub[kPclPxyziMsg];
   if (kOutputToRos == output_type_) {
     publisher_ptr->publish(cloud);
   } else {
@@ -501,15 +659,23 @@ void Lddc::PublishImuData(LidarImuDataQueue& imu_data_queue, const uint8_t index
     //printf("Publish imu data failed, imu data queue pop failed.\n");
     return;
   }
+  PublishImuSample(index, imu_data);
+}
+
+void Lddc::PublishImuSample(const uint8_t index, const ImuData& imu_data) {
+  if (!HasImuSubscribers(index)) {
+    CountSkippedFrame(publish_contexts_[index].imu_skipped, index, "imu");
+    return;
+  }
 
   ImuMsg imu_msg;
   uint64_t timestamp;
   InitImuMsg(imu_data, imu_msg, timestamp);
 
 #ifdef BUILDING_ROS1
-  PublisherPtr publisher_ptr = GetCurrentImuPublisher(index);
+  PublisherPtr publisher_ptr = publish_contexts_[index].imu_pub;
 #elif defined BUILDING_ROS2
-  Publisher<ImuMsg>::SharedPtr publisher_ptr = std::dynamic_pointer_cast<Publisher<ImuMsg>>(GetCurrentImuPublisher(index));
+  Publisher<ImuMsg>* publisher_ptr = publish_contexts_[index].imu_pub;
 #endif
 
   if (kOutputToRos == output_type_) {
@@ -521,19 +687,55 @@ void Lddc::PublishImuData(LidarImuDataQueue& imu_data_queue, const uint8_t index
     }
 #endif
   }
+  RecordImuLatency(index, imu_data);
+}
+
+void Lddc::RecordImuLatency(const uint8_t index, const ImuData& imu_data) {
+  uint64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+  uint64_t latency = (now > imu_data.recv_time) ? (now - imu_data.recv_time) : 0;
+
+  ImuLatencyStats& stats = publish_contexts_[index].imu_latency;
+  if (stats.count == 0) {
+    stats.min_ns = latency;
+    stats.max_ns = latency;
+    if (stats.window_start_ns == 0) {
+      stats.window_start_ns = now;
+    }
+  }
+  ++stats.count;
+  stats.sum_ns += latency;
+  stats.sum_sq_us += (latency / 1000.0) * (latency / 1000.0);
+  stats.min_ns = std::min(stats.min_ns, latency);
+  stats.max_ns = std::max(stats.max_ns, latency);
+
+  if (now - stats.window_start_ns < kImuLatencyReportPeriodNs) {
+    return;
+  }
+  double mean_us = stats.sum_ns / 1000.0 / stats.count;
+  double stddev_us = sqrt(std::max(0.0, stats.sum_sq_us / stats.count - mean_us * mean_us));
+  printf("Lidar[%u] imu receive to publish latency over %" PRIu64 " samples, min:%.1fus mean:%.1fus "
+         "max:%.1fus stddev:%.1fus.\n", index, stats.count, stats.min_ns / 1000.0, mean_us,
+         stats.max_ns / 1000.0, stddev_us);
+  stats = ImuLatencyStats{};
+  stats.window_start_ns = now;
 }
 
 #ifdef BUILDING_ROS2
 std::shared_ptr<rclcpp::PublisherBase> Lddc::CreatePublisher(uint8_t msg_type,
     std::string &topic_name, uint32_t queue_size) {
+    rclcpp::PublisherOptions options;
+    if (use_intra_process_comms_) {
+      options.use_intra_process_comm = rclcpp::IntraProcessSetting::Enable;
+    }
     if (kPointCloud2Msg == msg_type) {
       DRIVER_INFO(*cur_node_,
           "%s publish use PointCloud2 format", topic_name.c_str());
-      return cur_node_->create_publisher<PointCloud2>(topic_name, queue_size);
+      return cur_node_->create_publisher<PointCloud2>(topic_name, queue_size, options);
     } else if (kLivoxCustomMsg == msg_type) {
       DRIVER_INFO(*cur_node_,
           "%s publish use livox custom format", topic_name.c_str());
-      return cur_node_->create_publisher<CustomMsg>(topic_name, queue_size);
+      return cur_node_->create_publisher<CustomMsg>(topic_name, queue_size, options);
     }
 #if 0
     else if (kPclPxyziMsg == msg_type)  {
@@ -546,7 +748,7 @@ std::shared_ptr<rclcpp::PublisherBase> Lddc::CreatePublisher(uint8_t msg_type,
       DRIVER_INFO(*cur_node_,
           "%s publish use imu format", topic_name.c_str());
       return cur_node_->create_publisher<ImuMsg>(topic_name,
-          queue_size);
+          queue_size, options);
     } else {
       PublisherPtr null_publisher(nullptr);
       return null_publisher;
@@ -554,46 +756,57 @@ std::shared_ptr<rclcpp::PublisherBase> Lddc::CreatePublisher(uint8_t msg_type,
 }
 #endif
 
+/** xfer_format keeps the plain topic names, every extra format gets a suffix */
+static const char* PointCloudTopicSuffix(uint8_t format, uint8_t transfer_format) {
+  static const char* kSuffixes[kMaxPointCloudFormats] = {"_pointcloud2", "_custom", "_pcl"};
+  if (format == transfer_format || format >= kMaxPointCloudFormats) {
+    return "";
+  }
+  return kSuffixes[format];
+}
+
 #ifdef BUILDING_ROS1
-PublisherPtr Lddc::GetCurrentPublisher(uint8_t index) {
+PublisherPtr Lddc::GetCurrentPublisher(uint8_t index, uint8_t format) {
   ros::Publisher **pub = nullptr;
   uint32_t queue_size = kMinEthPacketQueueSize;
 
   if (use_multi_topic_) {
-    pub = &private_pub_[index];
+    pub = &private_pub_[format][index];
     queue_size = queue_size / 8; // queue size is 4 for only one lidar
   } else {
-    pub = &global_pub_;
+    pub = &global_pub_[format];
     queue_size = queue_size * 8; // shared queue size is 256, for all lidars
   }
 
   if (*pub == nullptr) {
-    char name_str[48];
+    char name_str[64];
     memset(name_str, 0, sizeof(name_str));
     if (use_multi_topic_) {
       std::string ip_string = IpNumToString(lds_->lidars_[index].handle);
-      snprintf(name_str, sizeof(name_str), "livox/lidar_%s",
-               ReplacePeriodByUnderline(ip_string).c_str());
+      snprintf(name_str, sizeof(name_str), "livox/lidar_%s%s",
+               ReplacePeriodByUnderline(ip_string).c_str(),
+               PointCloudTopicSuffix(format, transfer_format_));
       DRIVER_INFO(*cur_node_, "Support multi topics.");
     } else {
       DRIVER_INFO(*cur_node_, "Support only one topic.");
-      snprintf(name_str, sizeof(name_str), "livox/lidar");
+      snprintf(name_str, sizeof(name_str), "livox/lidar%s",
+               PointCloudTopicSuffix(format, transfer_format_));
     }
 
     *pub = new ros::Publisher;
-    if (kPointCloud2Msg == transfer_format_) {
+    if (kPointCloud2Msg == format) {
       **pub =
           cur_node_->GetNode().advertise<sensor_msgs::PointCloud2>(name_str, queue_size);
       DRIVER_INFO(*cur_node_,
           "%s publish use PointCloud2 format, set ROS publisher queue size %d",
           name_str, queue_size);
-    } else if (kLivoxCustomMsg == transfer_format_) {
+    } else if (kLivoxCustomMsg == format) {
       **pub = cur_node_->GetNode().advertise<livox_ros_driver2::CustomMsg>(name_str,
                                                                 queue_size);
       DRIVER_INFO(*cur_node_,
           "%s publish use livox custom format, set ROS publisher queue size %d",
           name_str, queue_size);
-    } else if (kPclPxyziMsg == transfer_format_) {
+    } else if (kPclPxyziMsg == format) {
       **pub = cur_node_->GetNode().advertise<PointCloud>(name_str, queue_size);
       DRIVER_INFO(*cur_node_,
           "%s publish use pcl PointXYZI format, set ROS publisher queue "
@@ -639,28 +852,30 @@ PublisherPtr Lddc::GetCurrentImuPublisher(uint8_t handle) {
   return *pub;
 }
 #elif defined BUILDING_ROS2
-std::shared_ptr<rclcpp::PublisherBase> Lddc::GetCurrentPublisher(uint8_t handle) {
+std::shared_ptr<rclcpp::PublisherBase> Lddc::GetCurrentPublisher(uint8_t handle, uint8_t format) {
   uint32_t queue_size = kMinEthPacketQueueSize;
   if (use_multi_topic_) {
-    if (!private_pub_[handle]) {
-      char name_str[48];
+    if (!private_pub_[format][handle]) {
+      char name_str[64];
       memset(name_str, 0, sizeof(name_str));
 
       std::string ip_string = IpNumToString(lds_->lidars_[handle].handle);
-      snprintf(name_str, sizeof(name_str), "livox/lidar_%s",
-          ReplacePeriodByUnderline(ip_string).c_str());
+      snprintf(name_str, sizeof(name_str), "livox/lidar_%s%s",
+          ReplacePeriodByUnderline(ip_string).c_str(),
+          PointCloudTopicSuffix(format, transfer_format_));
       std::string topic_name(name_str);
       queue_size = queue_size * 2; // queue size is 64 for only one lidar
-      private_pub_[handle] = CreatePublisher(transfer_format_, topic_name, queue_size);
+      private_pub_[format][handle] = CreatePublisher(format, topic_name, queue_size);
     }
-    return private_pub_[handle];
+    return private_pub_[format][handle];
   } else {
-    if (!global_pub_) {
+    if (!global_pub_[format]) {
       std::string topic_name("livox/lidar");
+      topic_name += PointCloudTopicSuffix(format, transfer_format_);
       queue_size = queue_size * 8; // shared queue size is 256, for all lidars
-      global_pub_ = CreatePublisher(transfer_format_, topic_name, queue_size);
+      global_pub_[format] = CreatePublisher(format, topic_name, queue_size);
     }
-    return global_pub_;
+    return global_pub_[format];
   }
 }
 
@@ -690,6 +905,46 @@ std::shared_ptr<rclcpp::PublisherBase> Lddc::GetCurrentImuPublisher(uint8_t hand
 }
 #endif
 
+void Lddc::RegisterLidarPublishers(uint8_t index) {
+  std::lock_guard<std::mutex> lock(register_mutex_);
+  LidarPublishContext& context = publish_contexts_[index];
+  if (context.registered) {
+    return;
+  }
+  if (point_cloud_format_num_ != 0) {
+    ResolvePointCloudPublisher(index);
+  }
+  ResolveImuPublisher(index);
+  context.registered = true;
+}
+
+void Lddc::ResolvePointCloudPublisher(uint8_t index) {
+  LidarPublishContext& context = publish_contexts_[index];
+  for (uint8_t i = 0; i < point_cloud_format_num_; ++i) {
+    uint8_t format = point_cloud_formats_[i];
+#ifdef BUILDING_ROS1
+    context.points_pub[format] = GetCurrentPublisher(index, format);
+#elif defined BUILDING_ROS2
+    PublisherPtr publisher_ptr = GetCurrentPublisher(index, format);
+    context.points_pub[format] = publisher_ptr.get();
+    if (kPointCloud2Msg == format) {
+      context.pointcloud2_pub = std::dynamic_pointer_cast<Publisher<PointCloud2>>(publisher_ptr).get();
+    } else if (kLivoxCustomMsg == format) {
+      context.custom_pub = std::dynamic_pointer_cast<Publisher<CustomMsg>>(publisher_ptr).get();
+    }
+#endif
+  }
+}
+
+void Lddc::ResolveImuPublisher(uint8_t index) {
+  LidarPublishContext& context = publish_contexts_[index];
+#ifdef BUILDING_ROS1
+  context.imu_pub = GetCurrentImuPublisher(index);
+#elif defined BUILDING_ROS2
+  context.imu_pub = std::dynamic_pointer_cast<Publisher<ImuMsg>>(GetCurrentImuPublisher(index)).get();
+#endif
+}
+
 void Lddc::CreateBagFile(const std::string &file_name) {
 #ifdef BUILDING_ROS1
   if (!bag_) {
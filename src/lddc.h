@@ -29,6 +29,7 @@
 
 #include "driver_node.h"
 #include "lds.h"
+#include "comm/pointcloud2_layout.h"
 
 namespace livox_ros {
 
@@ -46,6 +47,8 @@ typedef enum {
   kLivoxImuMsg = 3,
 } TransferType;
 
+const uint8_t kMaxPointCloudFormats = 3;  /**< PointCloud2, CustomMsg and PCL */
+
 /** Type-Definitions based on ROS versions */
 #ifdef BUILDING_ROS1
 using Publisher = ros::Publisher;
@@ -69,6 +72,40 @@ using PointCloud = pcl::PointCloud<pcl::PointXYZI>;
 
 class DriverNode;
 
+/** receive-to-publish latency of the imu samples of one lidar over a report window */
+typedef struct {
+  uint64_t count;
+  uint64_t sum_ns;
+  double sum_sq_us;
+  uint64_t min_ns;
+  uint64_t max_ns;
+  uint64_t window_start_ns;
+} ImuLatencyStats;
+
+constexpr uint64_t kImuLatencyReportPeriodNs = 10ull * 1000000000ull;
+
+/**
+ * Publishers of one lidar index, resolved to typed handles when the lidar registers with
+ * the Lds and only read afterwards. The counters are each only touched by their own
+ * distribute thread, the imu ones by the SDK thread instead with imu direct publish.
+ * The handles are owned by the publisher arrays of Lddc.
+ */
+typedef struct {
+  bool registered {};
+  uint64_t points_skipped[kMaxPointCloudFormats] {};  /**< frames not built, the topic had no subscriber */
+  uint64_t imu_skipped {};
+  ImuLatencyStats imu_latency {};
+#ifdef BUILDING_ROS1
+  ros::Publisher *points_pub[kMaxPointCloudFormats] {};  /**< by TransferType */
+  ros::Publisher *imu_pub {};
+#elif defined BUILDING_ROS2
+  rclcpp::PublisherBase *points_pub[kMaxPointCloudFormats] {};  /**< by TransferType */
+  rclcpp::Publisher<PointCloud2> *pointcloud2_pub {};
+  rclcpp::Publisher<CustomMsg> *custom_pub {};
+  rclcpp::Publisher<ImuMsg> *imu_pub {};
+#endif
+} LidarPublishContext;
+
 class Lddc final {
  public:
 #ifdef BUILDING_ROS1
@@ -92,28 +129,71 @@ class Lddc final {
 
   // void SetRosPub(ros::Publisher *pub) { global_pub_ = pub; };  // NOT USED
   void SetPublishFrq(uint32_t frq) { publish_frq_ = frq; }
+  // publish the formats in mask (bit n is TransferType n) next to transfer_format_
+  void SetXferFormatMask(uint32_t mask);
+  // PointCloud2 record layout, see PointCloud2LayoutType
+  void SetPointCloud2Layout(uint8_t layout);
+  // publish imu samples from the SDK thread instead of the imu queue, set before RegisterLds
+  void SetImuDirectPublish(bool enable) { imu_direct_publish_ = enable; }
+
+  // frames of lidar index not built because their topic had no subscriber
+  uint64_t GetSkippedFrames(uint8_t index, uint8_t format) {
+    return (format < kMaxPointCloudFormats) ? publish_contexts_[index].points_skipped[format] : 0;
+  }
+  uint64_t GetSkippedImuFrames(uint8_t index) { return publish_contexts_[index].imu_skipped; }
+#ifdef BUILDING_ROS2
+  // publish by loaned message where the RMW can loan, by unique_ptr otherwise
+  void SetUseLoanedMessages(bool enable) { use_loaned_messages_ = enable; }
+  // create publishers with intra-process comms on, frames are then published by unique_ptr
+  void SetUseIntraProcessComms(bool enable) { use_intra_process_comms_ = enable; }
+
+  // called with every point cloud message right before it is published by unique_ptr, lets
+  // test/test_intra_process.cpp check that the subscriber receives that very message
+  using MovedMessageObserver = void (*)(uint8_t format, const void* msg);
+  static void SetMovedMessageObserver(MovedMessageObserver observer);
+#endif
 
  public:
   Lds *lds_;
 
  private:
+  friend class LddcBenchmark;  /**< benchmark/lddc_benchmark.cpp times the message builders */
+
+  using PublishPointCloudFunc = void (Lddc::*)(StoragePacket& pkg, uint8_t index);
+  PublishPointCloudFunc SelectPointCloudPublisher(uint8_t format);
+  bool HasSubscribers(uint8_t index, uint8_t format);
+  void UpdateFusedPointCloud2();
+  bool HasImuSubscribers(uint8_t index);
+  void CountSkippedFrame(uint64_t& skipped, uint8_t index, const char* topic_type);
+
   void PollingLidarPointCloudData(uint8_t index, LidarDevice *lidar);
   void PollingLidarImuData(uint8_t index, LidarDevice *lidar);
 
-  void PublishPointcloud2(LidarDataQueue *queue, uint8_t index);
-  void PublishCustomPointcloud(LidarDataQueue *queue, uint8_t index);
-  void PublishPclMsg(LidarDataQueue *queue, uint8_t index);
+  void PublishPointcloud2(StoragePacket& pkg, uint8_t index);
+  void PublishCustomPointcloud(StoragePacket& pkg, uint8_t index);
+  void PublishPclMsg(StoragePacket& pkg, uint8_t index);
 
   void PublishImuData(LidarImuDataQueue& imu_data_queue, const uint8_t index);
+  void PublishImuSample(const uint8_t index, const ImuData& imu_data);
+  void RecordImuLatency(const uint8_t index, const ImuData& imu_data);
 
   void InitPointcloud2MsgHeader(PointCloud2& cloud);
-  void InitPointcloud2Msg(const StoragePacket& pkg, PointCloud2& cloud, uint64_t& timestamp);
+  void InitPointcloud2Msg(StoragePacket& pkg, PointCloud2& cloud, uint64_t& timestamp);
   void PublishPointcloud2Data(const uint8_t index, uint64_t timestamp, const PointCloud2& cloud);
 
   void InitCustomMsg(CustomMsg& livox_msg, const StoragePacket& pkg, uint8_t index);
   void FillPointsToCustomMsg(CustomMsg& livox_msg, const StoragePacket& pkg);
   void PublishCustomPointData(const CustomMsg& livox_msg, const uint8_t index);
 
+#ifdef BUILDING_ROS2
+  bool PublishByMove() const {
+    return (use_loaned_messages_ || use_intra_process_comms_) && (kOutputToRos == output_type_);
+  }
+  void PublishLoanedPointcloud2(StoragePacket& pkg, uint8_t index);
+  void PublishLoanedCustomPointcloud(StoragePacket& pkg, uint8_t index);
+  static void NotifyMovedMessage(uint8_t format, const void* msg);
+#endif
+
   void InitPclMsg(const StoragePacket& pkg, PointCloud& cloud, uint64_t& timestamp);
   void FillPointsToPclMsg(const StoragePacket& pkg, PointCloud& pcl_msg);
   void PublishPclData(const uint8_t index, const uint64_t timestamp, const PointCloud& cloud);
@@ -128,31 +208,49 @@ class Lddc final {
   PublisherPtr CreatePublisher(uint8_t msg_type, std::string &topic_name, uint32_t queue_size);
 #endif
 
-  PublisherPtr GetCurrentPublisher(uint8_t index);
+  PublisherPtr GetCurrentPublisher(uint8_t index, uint8_t format);
   PublisherPtr GetCurrentImuPublisher(uint8_t index);
+  void RegisterLidarPublishers(uint8_t index);
+  void ResolvePointCloudPublisher(uint8_t index);
+  void ResolveImuPublisher(uint8_t index);
 
  private:
   uint8_t transfer_format_;
+  uint32_t xfer_format_mask_;                   /**< every published format, bit n is TransferType n */
+  uint8_t point_cloud_format_num_;
+  uint8_t point_cloud_formats_[kMaxPointCloudFormats];
+  PublishPointCloudFunc point_cloud_publishers_[kMaxPointCloudFormats];  /**< chosen once per format */
+  const PointCloud2Layout* pointcloud2_layout_;
+  bool fused_pointcloud2_;                      /**< frames arrive as PointCloud2 records */
+  bool imu_direct_publish_;
   uint8_t use_multi_topic_;
   uint8_t data_src_;
   uint8_t output_type_;
   double publish_frq_;
   uint32_t publish_period_ns_;
   std::string frame_id_;
+  StoragePacket storage_packets_[kMaxSourceLidar];  /**< per lidar, swapped with the queue slots */
+  PointCloud2 pointcloud2_msgs_[kMaxSourceLidar];   /**< per lidar, keeps fields and data capacity */
+  CustomMsg custom_msgs_[kMaxSourceLidar];          /**< per lidar, keeps points capacity */
+  LidarPublishContext publish_contexts_[kMaxSourceLidar];
+  std::mutex register_mutex_;  /**< lidars register from the main, SDK or replay thread */
 
 #ifdef BUILDING_ROS1
   bool enable_lidar_bag_;
   bool enable_imu_bag_;
-  PublisherPtr private_pub_[kMaxSourceLidar];
-  PublisherPtr global_pub_;
+  PublisherPtr private_pub_[kMaxPointCloudFormats][kMaxSourceLidar];
+  PublisherPtr global_pub_[kMaxPointCloudFormats];
   PublisherPtr private_imu_pub_[kMaxSourceLidar];
   PublisherPtr global_imu_pub_;
   rosbag::Bag *bag_;
+  uint32_t custom_msg_seq_[kMaxSourceLidar];
 #elif defined BUILDING_ROS2
-  PublisherPtr private_pub_[kMaxSourceLidar];
-  PublisherPtr global_pub_;
+  PublisherPtr private_pub_[kMaxPointCloudFormats][kMaxSourceLidar];
+  PublisherPtr global_pub_[kMaxPointCloudFormats];
   PublisherPtr private_imu_pub_[kMaxSourceLidar];
   PublisherPtr global_imu_pub_;
+  bool use_loaned_messages_;
+  bool use_intra_process_comms_;
 #endif
 
   livox_ros::DriverNode *cur_node_;
@@ -22,6 +22,7 @@
 // SOFTWARE.
 //
 
+#include <inttypes.h>
 #include <math.h>
 #include <stdio.h>
 #include <string.h>
@@ -39,10 +40,11 @@ CacheIndex Lds::cache_index_;
 /* Member function --------------------------------------------------------- */
 Lds::Lds(const double publish_freq, const uint8_t data_src)
     : lidar_count_(kMaxSourceLidar),
-      pcd_semaphore_(0),
-      imu_semaphore_(0),
       publish_freq_(publish_freq),
       data_src_(data_src),
+      fused_pointcloud2_(false),
+      queue_overflow_policy_(kQueueDropNewest),
+      queue_block_timeout_ms_(kDefaultQueueBlockTimeoutMs),
       request_exit_(false) {
   ResetLds(data_src_);
 }
@@ -75,6 +77,8 @@ void Lds::ResetLds(uint8_t data_src) {
 
 void Lds::RequestExit() {
   request_exit_ = true;
+  pcd_ready_.Notify();
+  imu_ready_.Notify();
 }
 
 bool Lds::IsAllQueueEmpty() {
@@ -112,14 +116,19 @@ void Lds::StorageImuData(ImuData* imu_data) {
     return;
   }
 
-  LidarDevice *p_lidar = &lidars_[index];
-  LidarImuDataQueue* imu_queue = &p_lidar->imu_data;
-  imu_queue->Push(imu_data);
-  if (!imu_queue->Empty()) {
-    if (imu_semaphore_.GetCount() <= 0) {
-      imu_semaphore_.Signal();
+  if (imu_data_handler_) {
+    imu_data_handler_(index, *imu_data);
+    return;
+  }
+
+  LidarImuDataQueue* imu_queue = &lidars_[index].imu_data;
+  if (!imu_queue->Push(imu_data)) {
+    uint64_t drop_count = imu_queue->GetDropCount();
+    if (ShouldLogCount(drop_count)) {
+      printf("Lidar[%u] imu queue overflow, dropped samples:%" PRIu64 ".\n", index, drop_count);
     }
   }
+  imu_ready_.Set(index);
 }
 
 void Lds::StorageLvxPointData(PointFrame* frame) {
@@ -177,21 +186,21 @@ void Lds::PushLidarData(PointPacket* lidar_data, const uint8_t index, const uint
 
   if (nullptr == queue->storage_packet) {
     uint32_t queue_size = CalculatePacketQueueSize(publish_freq_);
-    InitQueue(queue, queue_size);
+    InitQueue(queue, queue_size, queue_overflow_policy_, queue_block_timeout_ms_);
     printf("Lidar[%u] storage queue size: %u\n", index, queue_size);
   }
 
-  if (!QueueIsFull(queue)) {
+  uint64_t dropped = QueueDropCount(queue);
+  if (QueueMakeRoom(queue)) {
     QueuePushAny(queue, (uint8_t *)lidar_data, base_time);
-    if (!QueueIsEmpty(queue)) {
-      if (pcd_semaphore_.GetCount() <= 0) {
-        pcd_semaphore_.Signal();
-      }
-    }
-  } else {
-    if (pcd_semaphore_.GetCount() <= 0) {
-        pcd_semaphore_.Signal();
-    }
+  }
+  // set after the push is released, or on overflow so the publisher drains the full queue
+  pcd_ready_.Set(index);
+
+  uint64_t drop_count = QueueDropCount(queue);
+  if (drop_count != dropped && ShouldLogCount(drop_count)) {
+    printf("Lidar[%u] storage queue overflow, dropped frames:%" PRIu64 ", peak used:%u/%u, policy:%u.\n",
+        index, drop_count, QueuePeakUsedSize(queue), queue->size, queue->overflow_policy);
   }
 }
 
@@ -27,9 +27,10 @@
 #ifndef LIVOX_ROS_DRIVER_LDS_H_
 #define LIVOX_ROS_DRIVER_LDS_H_
 
+#include <functional>
 #include <map>
 
-#include "comm/semaphore.h"
+#include "comm/ready_mask.h"
 #include "comm/comm.h"
 #include "comm/cache_index.h"
 
@@ -65,15 +66,45 @@ class Lds {
   // get publishing frequency
   double GetLdsFrequency() { return publish_freq_; }
 
+  // decode straight into PointCloud2 records, set by Lddc when that is the only output
+  void SetFusedPointCloud2(bool enable) { fused_pointcloud2_ = enable; }
+
+  // imu samples go to handler on the SDK thread instead of the imu queue, set before data flows
+  using ImuDataHandler = std::function<void(uint8_t index, const ImuData& imu_data)>;
+  void SetImuDataHandler(ImuDataHandler handler) { imu_data_handler_ = std::move(handler); }
+
+  // called once per lidar when it is given its index, before any of its data is stored
+  using LidarRegisteredHandler = std::function<void(uint8_t index)>;
+  void SetLidarRegisteredHandler(LidarRegisteredHandler handler) {
+    lidar_registered_handler_ = std::move(handler);
+  }
+  void NotifyLidarRegistered(uint8_t index) {
+    if (lidar_registered_handler_) {
+      lidar_registered_handler_(index);
+    }
+  }
+
+  // what a full lidar data queue does with a new frame, see QueueOverflowPolicy. Set before
+  // data flows, each queue takes it in InitQueue when it is created.
+  void SetQueueOverflowPolicy(uint8_t policy, uint32_t block_timeout_ms) {
+    queue_overflow_policy_ = policy;
+    queue_block_timeout_ms_ = block_timeout_ms;
+  }
+
  public:
   uint8_t lidar_count_;                 /**< Lidar access handle. */
   LidarDevice lidars_[kMaxSourceLidar]; /**< The index is the handle */
-  Semaphore pcd_semaphore_;
-  Semaphore imu_semaphore_;
+  ReadyMask pcd_ready_;  /**< bit per lidar index with queued frames */
+  ReadyMask imu_ready_;  /**< bit per lidar index with queued imu data */
   static CacheIndex cache_index_;
  protected:
   double publish_freq_;
   uint8_t data_src_;
+  bool fused_pointcloud2_;
+  uint8_t queue_overflow_policy_;
+  uint32_t queue_block_timeout_ms_;
+  ImuDataHandler imu_data_handler_;
+  LidarRegisteredHandler lidar_registered_handler_;
  private:
   volatile bool request_exit_;
 };
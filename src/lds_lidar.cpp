@@ -65,7 +65,9 @@ LdsLidar::LdsLidar(double publish_freq)
     : Lds(publish_freq, kSourceRawLidar), 
       auto_connect_mode_(true),
       whitelist_count_(0),
-      is_initialized_(false) {
+      is_initialized_(false),
+      packet_queue_size_(kDefaultRawPacketQueueSize),
+      decode_thread_per_lidar_(false) {
   memset(broadcast_code_whitelist_, 0, sizeof(broadcast_code_whitelist_));
   ResetLdsLidar();
 }
@@ -160,23 +162,10 @@ bool LdsLidar::InitLivoxLidar() {
     LidarExtParameter lidar_param;
     lidar_param.handle = config.handle;
     lidar_param.lidar_type = kLivoxLidarType;
-    if (config.pcl_data_type == kLivoxLidarCartesianCoordinateLowData) {
-      // temporary resolution
-      lidar_param.param.roll  = config.extrinsic_param.roll;
-      lidar_param.param.pitch = config.extrinsic_param.pitch;
-      lidar_param.param.yaw   = config.extrinsic_param.yaw;
-      lidar_param.param.x     = config.extrinsic_param.x / 10;
-      lidar_param.param.y     = config.extrinsic_param.y / 10;
-      lidar_param.param.z     = config.extrinsic_param.z / 10;
-    } else {
-      lidar_param.param.roll  = config.extrinsic_param.roll;
-      lidar_param.param.pitch = config.extrinsic_param.pitch;
-      lidar_param.param.yaw   = config.extrinsic_param.yaw;
-      lidar_param.param.x     = config.extrinsic_param.x;
-      lidar_param.param.y     = config.extrinsic_param.y;
-      lidar_param.param.z     = config.extrinsic_param.z;
-    }
+    lidar_param.param = config.extrinsic_param;
     pub_handler().AddLidarsExtParam(lidar_param);
+    pub_handler().SetLidarDecodeCpu(config.handle, config.decode_cpu);
+    g_lds_ldiar->NotifyLidarRegistered(index);
   }
 
   SetLivoxLidarInfoChangeCallback(LivoxLidarCallback::LidarInfoChangeCallback, g_lds_ldiar);
@@ -184,6 +173,12 @@ bool LdsLidar::InitLivoxLidar() {
 }
 
 void LdsLidar::SetLidarPubHandle() {
+  pub_handler().SetPacketQueueSize(packet_queue_size_);
+  pub_handler().SetDecodeThreadPerLidar(decode_thread_per_lidar_);
+  pub_handler().SetFusedPointCloud2(fused_pointcloud2_);
+  if (!packet_record_path_.empty()) {
+    pub_handler().StartPacketRecord(packet_record_path_);
+  }
   pub_handler().SetPointCloudsCallback(LidarCommonCallback::OnLidarPointClounCb, g_lds_ldiar);
   pub_handler().SetImuDataCallback(LidarCommonCallback::LidarImuDataCallback, g_lds_ldiar);
 
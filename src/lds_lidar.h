@@ -53,6 +53,11 @@ class LdsLidar final : public Lds {
   bool Start();
 
   int DeInitLdsLidar(void);
+
+  void SetPacketQueueSize(uint32_t queue_size) { packet_queue_size_ = queue_size; }
+  void SetDecodeThreadPerLidar(bool enable) { decode_thread_per_lidar_ = enable; }
+  // capture the raw packets to path, empty for no capture
+  void SetPacketRecordPath(const std::string& path) { packet_record_path_ = path; }
  private:
   LdsLidar(double publish_freq);
   LdsLidar(const LdsLidar &) = delete;
@@ -87,6 +92,9 @@ class LdsLidar final : public Lds {
   bool auto_connect_mode_;
   uint32_t whitelist_count_;
   volatile bool is_initialized_;
+  uint32_t packet_queue_size_;
+  bool decode_thread_per_lidar_;
+  std::string packet_record_path_;
   char broadcast_code_whitelist_[kMaxLidarCount][kBroadcastCodeSize];
 };
 
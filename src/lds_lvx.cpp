@@ -0,0 +1,372 @@
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2022 Livox. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+
+#include "lds_lvx.h"
+
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+
+#include "livox_lidar_def.h"
+
+namespace livox_ros {
+
+static_assert(sizeof(Lvx2PublicHeader) == 24, "LVX2 public header must be 24 bytes");
+static_assert(sizeof(Lvx2PrivateHeader) == 5, "LVX2 private header must be 5 bytes");
+static_assert(sizeof(Lvx2DeviceInfo) == 63, "LVX2 device info must be 63 bytes");
+static_assert(sizeof(Lvx2FrameHeader) == 24, "LVX2 frame header must be 24 bytes");
+static_assert(sizeof(Lvx2PackageHeader) == 27, "LVX2 package header must be 27 bytes");
+
+namespace {
+
+uint32_t GetRawPointSize(uint8_t data_type) {
+  if (data_type == kLivoxLidarCartesianCoordinateHighData) {
+    return sizeof(LivoxLidarCartesianHighRawPoint);
+  } else if (data_type == kLivoxLidarCartesianCoordinateLowData) {
+    return sizeof(LivoxLidarCartesianLowRawPoint);
+  } else if (data_type == kLivoxLidarSphericalCoordinateData) {
+    return sizeof(LivoxLidarSpherPoint);
+  }
+  return 0;
+}
+
+uint8_t GetLineNum(uint8_t device_type) {
+  if (device_type == LivoxLidarDeviceType::kLivoxLidarTypeIndustrialHAP) {
+    return kLineNumberHAP;
+  } else if (device_type == LivoxLidarDeviceType::kLivoxLidarTypeMid360) {
+    return kLineNumberMid360;
+  }
+  return kLineNumberDefault;
+}
+
+} // namespace
+
+LdsLvx::LdsLvx(double publish_freq)
+    : Lds(publish_freq, kSourceLvxFile),
+      fd_(-1),
+      file_data_(nullptr),
+      file_size_(0),
+      data_offset_(0),
+      frame_duration_ms_(kLvx2DefaultFrameDurationMs),
+      replay_rate_(1.0),
+      is_initialized_(false),
+      frame_count_(0),
+      package_count_(0),
+      point_count_(0) {
+  ResetLds(kSourceLvxFile);
+}
+
+LdsLvx::~LdsLvx() { DeInitLdsLvx(); }
+
+bool LdsLvx::InitLdsLvx(const std::string& lvx_path) {
+  if (is_initialized_) {
+    printf("Lds is already inited!\n");
+    return false;
+  }
+
+  if (!MapFile(lvx_path) || !ParseHeaders()) {
+    UnmapFile();
+    return false;
+  }
+
+  is_quit_.store(false);
+  replay_thread_ = std::make_shared<std::thread>(&LdsLvx::ReplayThread, this);
+  is_initialized_ = true;
+  return true;
+}
+
+int LdsLvx::DeInitLdsLvx(void) {
+  if (!is_initialized_) {
+    return -1;
+  }
+  is_quit_.store(true);
+  if (replay_thread_ && replay_thread_->joinable()) {
+    replay_thread_->join();
+  }
+  replay_thread_ = nullptr;
+  UnmapFile();
+  is_initialized_ = false;
+  return 0;
+}
+
+void LdsLvx::PrepareExit(void) { DeInitLdsLvx(); }
+
+bool LdsLvx::MapFile(const std::string& lvx_path) {
+  fd_ = open(lvx_path.c_str(), O_RDONLY);
+  if (fd_ < 0) {
+    printf("Open lvx file failed, path:%s.\n", lvx_path.c_str());
+    return false;
+  }
+
+  struct stat file_stat;
+  if (fstat(fd_, &file_stat) != 0 || file_stat.st_size == 0) {
+    printf("Lvx file is empty or can not be read, path:%s.\n", lvx_path.c_str());
+    return false;
+  }
+  file_size_ = static_cast<uint64_t>(file_stat.st_size);
+
+  void* data = mmap(nullptr, file_size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+  if (data == MAP_FAILED) {
+    printf("Map lvx file failed, path:%s, size:%" PRIu64 ".\n", lvx_path.c_str(), file_size_);
+    file_size_ = 0;
+    return false;
+  }
+  // frames are read front to back once, let the kernel read ahead
+  madvise(data, file_size_, MADV_SEQUENTIAL);
+  file_data_ = static_cast<const uint8_t*>(data);
+  printf("Map lvx file, path:%s, size:%" PRIu64 ".\n", lvx_path.c_str(), file_size_);
+  return true;
+}
+
+void LdsLvx::UnmapFile() {
+  if (file_data_) {
+    munmap(const_cast<uint8_t*>(file_data_), file_size_);
+    file_data_ = nullptr;
+  }
+  if (fd_ >= 0) {
+    close(fd_);
+    fd_ = -1;
+  }
+  file_size_ = 0;
+}
+
+bool LdsLvx::ParseHeaders() {
+  uint64_t offset = sizeof(Lvx2PublicHeader) + sizeof(Lvx2PrivateHeader);
+  if (file_size_ < offset) {
+    printf("Lvx file is too short for the lvx2 headers, size:%" PRIu64 ".\n", file_size_);
+    return false;
+  }
+
+  Lvx2PublicHeader public_header;
+  memcpy(&public_header, file_data_, sizeof(public_header));
+  if (public_header.magic_code != kLvx2MagicCode ||
+      strncmp(public_header.signature, "livox_tech", sizeof(public_header.signature)) != 0) {
+    printf("Not an lvx2 file, magic code:0x%x.\n", public_header.magic_code);
+    return false;
+  }
+
+  Lvx2PrivateHeader private_header;
+  memcpy(&private_header, file_data_ + sizeof(Lvx2PublicHeader), sizeof(private_header));
+  if (private_header.frame_duration != 0) {
+    frame_duration_ms_ = private_header.frame_duration;
+  }
+
+  if (file_size_ < offset + private_header.device_count * sizeof(Lvx2DeviceInfo)) {
+    printf("Lvx file is too short for %u device infos.\n", private_header.device_count);
+    return false;
+  }
+  for (uint8_t i = 0; i < private_header.device_count; ++i) {
+    Lvx2DeviceInfo info;
+    memcpy(&info, file_data_ + offset, sizeof(info));
+    offset += sizeof(info);
+    AddDevice(info);
+  }
+  data_offset_ = offset;
+
+  printf("Lvx2 file version:%u.%u.%u.%u, frame duration:%ums, devices:%u, replay rate:%.2f.\n",
+         public_header.version[0], public_header.version[1], public_header.version[2],
+         public_header.version[3], frame_duration_ms_, private_header.device_count, replay_rate_);
+  return true;
+}
+
+LdsLvx::LvxDevice& LdsLvx::AddDevice(const Lvx2DeviceInfo& info) {
+  LvxDevice& device = devices_[info.lidar_id];
+  if (device.handler) {
+    return device;
+  }
+
+  device.handler.reset(new LidarPubHandler());
+  device.handler->SetFusedPointCloud2(fused_pointcloud2_);
+  device.line_num = GetLineNum(info.device_type);
+  device.extrinsic_enable = (info.extrinsic_enable != 0);
+  device.last_time_stamp = 0;
+  device.last_point_num = 0;
+  device.point_interval = 0;
+  if (device.extrinsic_enable) {
+    // the file stores the translation in meter, it is applied as is whatever the packet unit
+    device.handler->SetExtrinsic(info.roll, info.pitch, info.yaw, info.x, info.y, info.z);
+  }
+
+  // the topic names and CustomMsg lidar_id come from the device slot
+  uint8_t index = 0;
+  if (cache_index_.LvxGetIndex(kLivoxLidarType, info.lidar_id, index) == 0) {
+    lidars_[index].lidar_type = kLivoxLidarType;
+    lidars_[index].handle = info.lidar_id;
+    NotifyLidarRegistered(index);
+  }
+  return device;
+}
+
+void LdsLvx::ReplayThread() {
+  const uint64_t frame_duration_ns = static_cast<uint64_t>(frame_duration_ms_) * kRatioOfMsToNs;
+  const uint64_t publish_period_ns = static_cast<uint64_t>(kNsPerSecond / publish_freq_);
+  uint64_t next_publish_ns = publish_period_ns;
+  uint64_t offset = data_offset_;
+  auto start = std::chrono::steady_clock::now();
+
+  while (!is_quit_.load() && !IsRequestExit() && offset < file_size_) {
+    if (replay_rate_ > 0.0) {
+      auto due = start + std::chrono::nanoseconds(
+          static_cast<uint64_t>(frame_count_ * frame_duration_ns / replay_rate_));
+      std::this_thread::sleep_until(due);
+    }
+
+    uint64_t next_offset = 0;
+    if (!ReplayFrame(offset, next_offset)) {
+      break;
+    }
+    offset = next_offset;
+    ++frame_count_;
+
+    // frames are cut on the recorded timeline, so the replay rate does not change them
+    uint64_t file_time_ns = frame_count_ * frame_duration_ns;
+    if (file_time_ns >= next_publish_ns) {
+      PublishFrames();
+      while (next_publish_ns <= file_time_ns) {
+        next_publish_ns += publish_period_ns;
+      }
+    }
+  }
+  PublishFrames();
+
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  printf("Lvx replay done, frames:%" PRIu64 ", packages:%" PRIu64 ", points:%" PRIu64 ", "
+         "elapsed:%.3fs, %.2f Mpts/s.\n",
+         frame_count_, package_count_, point_count_, elapsed.count(),
+         point_count_ / std::max(elapsed.count(), 1e-9) / 1e6);
+}
+
+bool LdsLvx::ReplayFrame(uint64_t offset, uint64_t& next_offset) {
+  if (offset + sizeof(Lvx2FrameHeader) > file_size_) {
+    printf("Lvx frame header at %" PRIu64 " is truncated, stop replay.\n", offset);
+    return false;
+  }
+  Lvx2FrameHeader frame_header;
+  memcpy(&frame_header, file_data_ + offset, sizeof(frame_header));
+
+  // the last frame of a file may be written without its next offset
+  uint64_t frame_end = frame_header.next_offset;
+  if (frame_end <= offset || frame_end > file_size_) {
+    frame_end = file_size_;
+  }
+
+  uint64_t package_offset = offset + sizeof(Lvx2FrameHeader);
+  while (package_offset + sizeof(Lvx2PackageHeader) <= frame_end) {
+    Lvx2PackageHeader package_header;
+    memcpy(&package_header, file_data_ + package_offset, sizeof(package_header));
+    package_offset += sizeof(Lvx2PackageHeader);
+    if (package_offset + package_header.length > frame_end) {
+      printf("Lvx package of frame %" PRIu64 " is truncated, stop replay.\n", frame_header.frame_index);
+      return false;
+    }
+    ProcessPackage(package_header, file_data_ + package_offset);
+    package_offset += package_header.length;
+  }
+  next_offset = frame_end;
+  return true;
+}
+
+void LdsLvx::ProcessPackage(const Lvx2PackageHeader& header, const uint8_t* data) {
+  uint32_t point_size = GetRawPointSize(header.data_type);
+  if (point_size == 0) {
+    return;
+  }
+  uint32_t point_num = header.length / point_size;
+  if (point_num == 0) {
+    return;
+  }
+
+  auto iter = devices_.find(header.lidar_id);
+  if (iter == devices_.end()) {
+    // a package from a device the header does not list, replay it without extrinsic
+    Lvx2DeviceInfo info;
+    memset(&info, 0, sizeof(info));
+    info.lidar_id = header.lidar_id;
+    AddDevice(info);
+    iter = devices_.find(header.lidar_id);
+  }
+  LvxDevice& device = iter->second;
+
+  LdsStamp time;
+  memcpy(time.stamp_bytes, header.timestamp, sizeof(time.stamp_bytes));
+  uint64_t time_stamp = static_cast<uint64_t>(time.stamp);
+  // packages carry no point interval, spread the points over the gap to the previous one
+  if (device.last_point_num != 0 && time_stamp > device.last_time_stamp) {
+    device.point_interval = (time_stamp - device.last_time_stamp) / device.last_point_num;
+  }
+  device.last_time_stamp = time_stamp;
+  device.last_point_num = point_num;
+
+  // recorded packages may exceed one raw packet, feed them in whole point chunks
+  const uint32_t max_points = KEthPacketMaxLength / point_size;
+  RawPacket& pkt = raw_packet_;
+  pkt.lidar_type = kLivoxLidarType;
+  pkt.handle = header.lidar_id;
+  // a recording without extrinsic is only converted to meter
+  pkt.extrinsic_enable = !device.extrinsic_enable;
+  pkt.data_type = header.data_type;
+  pkt.line_num = device.line_num;
+  pkt.point_interval = device.point_interval;
+  for (uint32_t done = 0; done < point_num; done += pkt.point_num) {
+    pkt.point_num = std::min(point_num - done, max_points);
+    pkt.time_stamp = time_stamp + done * device.point_interval;
+    pkt.data_length = pkt.point_num * point_size;
+    memcpy(pkt.raw_data, data + done * point_size, pkt.data_length);
+    device.handler->PointCloudProcess(pkt);
+  }
+  ++package_count_;
+  point_count_ += point_num;
+}
+
+void LdsLvx::PublishFrames() {
+  frame_.lidar_num = 0;
+  for (auto& item : devices_) {
+    LvxDevice& device = item.second;
+    device.points.clear();
+    uint64_t base_time = device.handler->GetLidarPointClouds(device.points);
+    if (device.points.empty() || frame_.lidar_num >= kMaxSourceLidar) {
+      continue;
+    }
+    frame_.base_time[frame_.lidar_num] = base_time;
+    PointPacket& lidar_point = frame_.lidar_point[frame_.lidar_num];
+    lidar_point.lidar_type = kLivoxLidarType;
+    lidar_point.handle = item.first;
+    lidar_point.points_num = device.points.size() / kPointRecordSize;
+    lidar_point.points = reinterpret_cast<PointXyzlt*>(device.points.data());
+    lidar_point.buffer = &device.points;
+    frame_.lidar_num++;
+  }
+  if (frame_.lidar_num != 0) {
+    StorageLvxPointData(&frame_);
+  }
+}
+
+}  // namespace livox_ros
@@ -0,0 +1,160 @@
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2022 Livox. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+
+/** LVX2 file data source, replays a recorded file through the live frame pipeline */
+
+#ifndef LIVOX_ROS_DRIVER_LDS_LVX_H_
+#define LIVOX_ROS_DRIVER_LDS_LVX_H_
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "lds.h"
+#include "comm/comm.h"
+#include "comm/pub_handler.h"
+
+namespace livox_ros {
+
+#pragma pack(1)
+
+typedef struct {
+  char signature[16];  /**< "livox_tech" */
+  uint8_t version[4];
+  uint32_t magic_code;
+} Lvx2PublicHeader;
+
+typedef struct {
+  uint32_t frame_duration;  /**< ms */
+  uint8_t device_count;
+} Lvx2PrivateHeader;
+
+typedef struct {
+  char lidar_sn[16];
+  char hub_sn[16];
+  uint32_t lidar_id;
+  uint8_t lidar_type;
+  uint8_t device_type;
+  uint8_t extrinsic_enable;
+  float roll;   /**< degree */
+  float pitch;
+  float yaw;
+  float x;      /**< m */
+  float y;
+  float z;
+} Lvx2DeviceInfo;
+
+typedef struct {
+  uint64_t current_offset;
+  uint64_t next_offset;
+  uint64_t frame_index;
+} Lvx2FrameHeader;
+
+typedef struct {
+  uint8_t version;
+  uint32_t lidar_id;
+  uint8_t lidar_type;
+  uint8_t timestamp_type;
+  uint8_t timestamp[8];
+  uint16_t udp_counter;
+  uint8_t data_type;
+  uint32_t length;       /**< bytes of point data after the header */
+  uint8_t frame_counter;
+  uint8_t reserved[4];
+} Lvx2PackageHeader;
+
+#pragma pack()
+
+const uint32_t kLvx2MagicCode = 0xAC0EA767;
+const uint32_t kLvx2DefaultFrameDurationMs = 50;
+
+class LdsLvx final : public Lds {
+ public:
+  static LdsLvx *GetInstance(double publish_freq) {
+    printf("LdsLvx *GetInstance\n");
+    static LdsLvx lds_lvx(publish_freq);
+    return &lds_lvx;
+  }
+
+  bool InitLdsLvx(const std::string& lvx_path);
+  int DeInitLdsLvx(void);
+
+  // 1.0 replays in real time, N at N times the recorded rate, 0 as fast as it decodes
+  void SetReplayRate(double rate) { replay_rate_ = (rate > 0.0) ? rate : 0.0; }
+
+ private:
+  typedef struct {
+    std::unique_ptr<LidarPubHandler> handler;
+    std::vector<uint8_t> points;   /**< frame buffer, swapped with the handler and the queue */
+    uint8_t line_num;
+    bool extrinsic_enable;
+    uint64_t last_time_stamp;
+    uint32_t last_point_num;
+    uint64_t point_interval;       /**< ns, estimated from the previous package */
+  } LvxDevice;
+
+  LdsLvx(double publish_freq);
+  LdsLvx(const LdsLvx &) = delete;
+  ~LdsLvx();
+  LdsLvx &operator=(const LdsLvx &) = delete;
+
+  bool MapFile(const std::string& lvx_path);
+  void UnmapFile();
+  bool ParseHeaders();
+  LvxDevice& AddDevice(const Lvx2DeviceInfo& info);
+
+  void ReplayThread();
+  bool ReplayFrame(uint64_t offset, uint64_t& next_offset);
+  void ProcessPackage(const Lvx2PackageHeader& header, const uint8_t* data);
+  void PublishFrames();
+
+  virtual void PrepareExit(void);
+
+ private:
+  int fd_;
+  const uint8_t* file_data_;
+  uint64_t file_size_;
+  uint64_t data_offset_;        /**< first frame header */
+  uint32_t frame_duration_ms_;
+  double replay_rate_;
+  volatile bool is_initialized_;
+
+  std::map<uint32_t, LvxDevice> devices_;  /**< by lidar id */
+  RawPacket raw_packet_;
+  PointFrame frame_;
+  uint64_t frame_count_;
+  uint64_t package_count_;
+  uint64_t point_count_;
+
+  std::shared_ptr<std::thread> replay_thread_;
+  std::atomic<bool> is_quit_{false};
+};
+
+}  // namespace livox_ros
+
+#endif // LIVOX_ROS_DRIVER_LDS_LVX_H_
@@ -0,0 +1,223 @@
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2022 Livox. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+
+#include "lds_replay.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "comm/pub_handler.h"
+#include "parse_cfg_file/parse_livox_lidar_cfg.h"
+
+namespace livox_ros {
+
+LdsReplay::LdsReplay(double publish_freq)
+    : Lds(publish_freq, kSourcePacketFile),
+      replay_rate_(1.0),
+      packet_queue_size_(kDefaultRawPacketQueueSize),
+      decode_thread_per_lidar_(false),
+      synthetic_(false),
+      is_initialized_(false) {
+  ResetLds(kSourcePacketFile);
+}
+
+LdsReplay::~LdsReplay() { DeInitLdsReplay(); }
+
+bool LdsReplay::InitLdsReplay(const std::string& replay_path, const std::string& config_path) {
+  if (is_initialized_) {
+    printf("Lds is already inited!\n");
+    return false;
+  }
+
+  if (!replayer_.Open(replay_path)) {
+    return false;
+  }
+  synthetic_ = false;
+  StartReplay(config_path);
+  return true;
+}
+
+bool LdsReplay::InitLdsSynthetic(const PacketGeneratorConfig& config, const std::string& config_path) {
+  if (is_initialized_) {
+    printf("Lds is already inited!\n");
+    return false;
+  }
+
+  if (!generator_.Init(config)) {
+    return false;
+  }
+  synthetic_ = true;
+  ResetLds(kSourceSynthetic);
+  StartReplay(config_path);
+  return true;
+}
+
+void LdsReplay::StartReplay(const std::string& config_path) {
+  ParseUserConfig(config_path);
+  // PubHandler reads the extrinsics map unlocked on its decode thread, so every lidar
+  // has to be in it before the first packet
+  std::vector<uint32_t> handles = synthetic_ ? generator_.GetHandles() : replayer_.ScanHandles();
+  for (uint32_t handle : handles) {
+    AddLidar(handle);
+  }
+  SetPubHandle();
+
+  is_quit_.store(false);
+  if (synthetic_) {
+    replay_thread_ = std::make_shared<std::thread>(&LdsReplay::GenerateThread, this);
+  } else {
+    replay_thread_ = std::make_shared<std::thread>(&LdsReplay::ReplayThread, this);
+  }
+  is_initialized_ = true;
+}
+
+int LdsReplay::DeInitLdsReplay(void) {
+  if (!is_initialized_) {
+    return -1;
+  }
+  is_quit_.store(true);
+  if (replay_thread_ && replay_thread_->joinable()) {
+    replay_thread_->join();
+  }
+  replay_thread_ = nullptr;
+  replayer_.Close();
+  is_initialized_ = false;
+  return 0;
+}
+
+void LdsReplay::PrepareExit(void) { DeInitLdsReplay(); }
+
+void LdsReplay::ParseUserConfig(const std::string& config_path) {
+  if (config_path.empty()) {
+    return;
+  }
+  LivoxLidarConfigParser parser(config_path);
+  std::vector<UserLivoxLidarConfig> user_configs;
+  if (!parser.Parse(user_configs)) {
+    printf("Failed to parse user-defined config, replay without extrinsics.\n");
+    return;
+  }
+
+  // the same extrinsics the live source would apply to these lidars
+  for (auto& config : user_configs) {
+    AddLidar(config.handle);
+    uint8_t index = 0;
+    if (cache_index_.GetIndex(kLivoxLidarType, config.handle, index) == 0) {
+      lidars_[index].livox_config = config;
+    }
+
+    LidarExtParameter lidar_param;
+    lidar_param.handle = config.handle;
+    lidar_param.lidar_type = kLivoxLidarType;
+    lidar_param.param = config.extrinsic_param;
+    pub_handler().AddLidarsExtParam(lidar_param);
+    pub_handler().SetLidarDecodeCpu(config.handle, config.decode_cpu);
+  }
+}
+
+void LdsReplay::AddLidar(uint32_t handle) {
+  if (!handles_.insert(handle).second) {
+    return;
+  }
+  uint8_t index = 0;
+  if (cache_index_.GetFreeIndex(kLivoxLidarType, handle, index) != 0) {
+    printf("Failed to get free index, lidar ip: %s.\n", IpNumToString(handle).c_str());
+    return;
+  }
+  LidarDevice *p_lidar = &lidars_[index];
+  p_lidar->lidar_type = kLivoxLidarType;
+  p_lidar->handle = handle;
+  // a replayed lidar samples from its first packet on, there is no work mode handshake
+  p_lidar->connect_state = kConnectStateSampling;
+
+  // identity until the user config sets one, the handler default is not an identity
+  LidarExtParameter lidar_param;
+  memset(&lidar_param, 0, sizeof(lidar_param));
+  lidar_param.handle = handle;
+  lidar_param.lidar_type = kLivoxLidarType;
+  pub_handler().AddLidarsExtParam(lidar_param);
+  NotifyLidarRegistered(index);
+}
+
+void LdsReplay::SetPubHandle() {
+  pub_handler().SetPacketQueueSize(packet_queue_size_);
+  pub_handler().SetDecodeThreadPerLidar(decode_thread_per_lidar_);
+  pub_handler().SetFusedPointCloud2(fused_pointcloud2_);
+  pub_handler().SetSdkPacketSource(false);
+  pub_handler().SetPointCloudsCallback(OnPointCloud, this);
+  pub_handler().SetImuDataCallback(OnImuData, this);
+  pub_handler().SetPointCloudConfig(Lds::GetLdsFrequency());
+}
+
+void LdsReplay::ReplayThread() {
+  auto start = std::chrono::steady_clock::now();
+  uint64_t packet_num = replayer_.Replay(
+      [](uint32_t handle, uint8_t dev_type, LivoxLidarEthernetPacket* data) {
+        pub_handler().InjectPacket(handle, dev_type, data);
+      },
+      replay_rate_, &is_quit_);
+
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  double recorded = replayer_.GetDuration() / 1e9;
+  printf("Packet replay done, packets:%" PRIu64 ", skipped:%" PRIu64 ", lidars:%zu, recorded:%.3fs, "
+         "elapsed:%.3fs, %.0f packets/s.\n", packet_num, replayer_.GetSkipCount(), handles_.size(), recorded,
+         elapsed.count(), packet_num / std::max(elapsed.count(), 1e-9));
+}
+
+void LdsReplay::GenerateThread() {
+  auto start = std::chrono::steady_clock::now();
+  uint64_t packet_num = generator_.Run(
+      [](uint32_t handle, uint8_t dev_type, LivoxLidarEthernetPacket* data) {
+        pub_handler().InjectPacket(handle, dev_type, data);
+      },
+      &is_quit_);
+
+  // a lag that keeps growing means the driver, not the generator, set the pace
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  printf("Synthetic load done, packets:%" PRIu64 ", points:%" PRIu64 ", imu:%" PRIu64 ", "
+         "elapsed:%.3fs, %.2f Mpts/s, max lag:%.3fms.\n", packet_num, generator_.GetPointCount(), generator_.GetImuCount(),
+         elapsed.count(), generator_.GetPointCount() / std::max(elapsed.count(), 1e-9) / 1e6,
+         generator_.GetMaxLag() / 1e6);
+}
+
+void LdsReplay::OnPointCloud(PointFrame* frame, void* client_data) {
+  if (frame == nullptr || client_data == nullptr || frame->lidar_num == 0) {
+    return;
+  }
+  static_cast<LdsReplay *>(client_data)->StoragePointData(frame);
+}
+
+void LdsReplay::OnImuData(ImuData* imu_data, void* client_data) {
+  if (imu_data == nullptr || client_data == nullptr) {
+    return;
+  }
+  static_cast<LdsReplay *>(client_data)->StorageImuData(imu_data);
+}
+
+}  // namespace livox_ros
@@ -0,0 +1,96 @@
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2022 Livox. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+/** Packet replay data source, feeds captured or synthetic lidar packets to the SDK callback entry point */
+
+#ifndef LIVOX_ROS_DRIVER_LDS_REPLAY_H_
+#define LIVOX_ROS_DRIVER_LDS_REPLAY_H_
+
+#include <atomic>
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>
+
+#include "lds.h"
+#include "comm/comm.h"
+#include "comm/packet_generator.h"
+#include "comm/packet_replayer.h"
+
+namespace livox_ros {
+
+class LdsReplay final : public Lds {
+ public:
+  static LdsReplay *GetInstance(double publish_freq) {
+    printf("LdsReplay *GetInstance\n");
+    static LdsReplay lds_replay(publish_freq);
+    return &lds_replay;
+  }
+
+  /** config_path is the usual user config, used for the extrinsics and may be empty */
+  bool InitLdsReplay(const std::string& replay_path, const std::string& config_path);
+  /** same as a replay, with the packets fabricated for config.lidar_num virtual lidars */
+  bool InitLdsSynthetic(const PacketGeneratorConfig& config, const std::string& config_path);
+  int DeInitLdsReplay(void);
+
+  // 1.0 replays in real time, N at N times the recorded rate, 0 as fast as it decodes
+  void SetReplayRate(double rate) { replay_rate_ = (rate > 0.0) ? rate : 0.0; }
+  void SetPacketQueueSize(uint32_t queue_size) { packet_queue_size_ = queue_size; }
+  void SetDecodeThreadPerLidar(bool enable) { decode_thread_per_lidar_ = enable; }
+
+ private:
+  LdsReplay(double publish_freq);
+  LdsReplay(const LdsReplay &) = delete;
+  ~LdsReplay();
+  LdsReplay &operator=(const LdsReplay &) = delete;
+
+  void ParseUserConfig(const std::string& config_path);
+  void AddLidar(uint32_t handle);
+  void SetPubHandle();
+  void StartReplay(const std::string& config_path);
+  void ReplayThread();
+  void GenerateThread();
+
+  static void OnPointCloud(PointFrame* frame, void* client_data);
+  static void OnImuData(ImuData* imu_data, void* client_data);
+
+  virtual void PrepareExit(void);
+
+ private:
+  PacketReplayer replayer_;
+  PacketGenerator generator_;
+  double replay_rate_;
+  uint32_t packet_queue_size_;
+  bool decode_thread_per_lidar_;
+  bool synthetic_;
+  volatile bool is_initialized_;
+  std::set<uint32_t> handles_;  /**< lidars with a device slot, all added before the replay thread starts */
+
+  std::shared_ptr<std::thread> replay_thread_;
+  std::atomic<bool> is_quit_{false};
+};
+
+}  // namespace livox_ros
+
+#endif // LIVOX_ROS_DRIVER_LDS_REPLAY_H_
@@ -23,6 +23,7 @@
 //
 
 #include <iostream>
+#include <algorithm>
 #include <chrono>
 #include <vector>
 #include <csignal>
@@ -33,6 +34,8 @@
 #include "driver_node.h"
 #include "lddc.h"
 #include "lds_lidar.h"
+#include "lds_lvx.h"
+#include "lds_replay.h"
 
 using namespace livox_ros;
 
@@ -59,6 +62,24 @@ int main(int argc, char **argv) {
   std::string frame_id = "livox_frame";
   bool lidar_bag = true;
   bool imu_bag   = false;
+  int packet_queue_size = kDefaultRawPacketQueueSize;
+  int decode_thread_per_lidar = 0;
+  int xfer_format_mask = 0;
+  int pointcloud2_layout = kPointCloud2LayoutXyzrtlt;
+  int queue_overflow_policy = kQueueDropNewest;
+  int queue_block_timeout_ms = kDefaultQueueBlockTimeoutMs;
+  int imu_direct_publish = 0;
+  double lvx_replay_rate = 1.0;
+  std::string packet_record_path;
+  std::string packet_replay_path;
+  double packet_replay_rate = 1.0;
+  int synthetic_lidar_num = 1;
+  int synthetic_dev_type = LivoxLidarDeviceType::kLivoxLidarTypeMid360;
+  int synthetic_data_type = kLivoxLidarCartesianCoordinateHighData;
+  int synthetic_point_rate = 0;
+  int synthetic_imu_rate = kDefaultSyntheticImuRate;
+  int synthetic_time_sync = 1;
+  double synthetic_duration = 0.0;
 
   livox_node.GetNode().getParam("xfer_format", xfer_format);
   livox_node.GetNode().getParam("multi_topic", multi_topic);
@@ -68,6 +89,24 @@ int main(int argc, char **argv) {
   livox_node.GetNode().getParam("frame_id", frame_id);
   livox_node.GetNode().getParam("enable_lidar_bag", lidar_bag);
   livox_node.GetNode().getParam("enable_imu_bag", imu_bag);
+  livox_node.GetNode().getParam("packet_queue_size", packet_queue_size);
+  livox_node.GetNode().getParam("decode_thread_per_lidar", decode_thread_per_lidar);
+  livox_node.GetNode().getParam("xfer_format_mask", xfer_format_mask);
+  livox_node.GetNode().getParam("pointcloud2_layout", pointcloud2_layout);
+  livox_node.GetNode().getParam("queue_overflow_policy", queue_overflow_policy);
+  livox_node.GetNode().getParam("queue_block_timeout_ms", queue_block_timeout_ms);
+  livox_node.GetNode().getParam("imu_direct_publish", imu_direct_publish);
+  livox_node.GetNode().getParam("lvx_replay_rate", lvx_replay_rate);
+  livox_node.GetNode().getParam("packet_record_path", packet_record_path);
+  livox_node.GetNode().getParam("packet_replay_path", packet_replay_path);
+  livox_node.GetNode().getParam("packet_replay_rate", packet_replay_rate);
+  livox_node.GetNode().getParam("synthetic_lidar_num", synthetic_lidar_num);
+  livox_node.GetNode().getParam("synthetic_dev_type", synthetic_dev_type);
+  livox_node.GetNode().getParam("synthetic_data_type", synthetic_data_type);
+  livox_node.GetNode().getParam("synthetic_point_rate", synthetic_point_rate);
+  livox_node.GetNode().getParam("synthetic_imu_rate", synthetic_imu_rate);
+  livox_node.GetNode().getParam("synthetic_time_sync", synthetic_time_sync);
+  livox_node.GetNode().getParam("synthetic_duration", synthetic_duration);
 
   printf("data source:%u.\n", data_src);
 
@@ -85,6 +124,9 @@ int main(int argc, char **argv) {
   livox_node.lddc_ptr_ = std::make_unique<Lddc>(xfer_format, multi_topic, data_src, output_type,
                         publish_freq, frame_id, lidar_bag, imu_bag);
   livox_node.lddc_ptr_->SetRosNode(&livox_node);
+  livox_node.lddc_ptr_->SetXferFormatMask(xfer_format_mask);
+  livox_node.lddc_ptr_->SetPointCloud2Layout(pointcloud2_layout);
+  livox_node.lddc_ptr_->SetImuDirectPublish(imu_direct_publish != 0);
 
   if (data_src == kSourceRawLidar) {
     DRIVER_INFO(livox_node, "Data Source is raw lidar.");
@@ -95,12 +137,78 @@ int main(int argc, char **argv) {
 
     LdsLidar *read_lidar = LdsLidar::GetInstance(publish_freq);
     livox_node.lddc_ptr_->RegisterLds(static_cast<Lds *>(read_lidar));
+    read_lidar->SetPacketQueueSize(packet_queue_size);
+    read_lidar->SetDecodeThreadPerLidar(decode_thread_per_lidar != 0);
+    read_lidar->SetQueueOverflowPolicy(queue_overflow_policy, queue_block_timeout_ms);
+    read_lidar->SetPacketRecordPath(packet_record_path);
 
     if ((read_lidar->InitLdsLidar(user_config_path))) {
       DRIVER_INFO(livox_node, "Init lds lidar successfully!");
     } else {
       DRIVER_ERROR(livox_node, "Init lds lidar failed!");
     }
+  } else if (data_src == kSourceLvxFile) {
+    DRIVER_INFO(livox_node, "Data Source is lvx file.");
+
+    std::string lvx_file_path;
+    livox_node.getParam("lvx_file_path", lvx_file_path);
+    DRIVER_INFO(livox_node, "Lvx file : %s", lvx_file_path.c_str());
+
+    LdsLvx *read_lvx = LdsLvx::GetInstance(publish_freq);
+    livox_node.lddc_ptr_->RegisterLds(static_cast<Lds *>(read_lvx));
+    read_lvx->SetQueueOverflowPolicy(queue_overflow_policy, queue_block_timeout_ms);
+    read_lvx->SetReplayRate(lvx_replay_rate);
+
+    if ((read_lvx->InitLdsLvx(lvx_file_path))) {
+      DRIVER_INFO(livox_node, "Init lds lvx successfully!");
+    } else {
+      DRIVER_ERROR(livox_node, "Init lds lvx failed!");
+    }
+  } else if (data_src == kSourcePacketFile) {
+    DRIVER_INFO(livox_node, "Data Source is packet file.");
+
+    std::string user_config_path;
+    livox_node.getParam("user_config_path", user_config_path);
+    DRIVER_INFO(livox_node, "Packet file : %s", packet_replay_path.c_str());
+
+    LdsReplay *read_replay = LdsReplay::GetInstance(publish_freq);
+    livox_node.lddc_ptr_->RegisterLds(static_cast<Lds *>(read_replay));
+    read_replay->SetPacketQueueSize(packet_queue_size);
+    read_replay->SetDecodeThreadPerLidar(decode_thread_per_lidar != 0);
+    read_replay->SetQueueOverflowPolicy(queue_overflow_policy, queue_block_timeout_ms);
+    read_replay->SetReplayRate(packet_replay_rate);
+
+    if ((read_replay->InitLdsReplay(packet_replay_path, user_config_path))) {
+      DRIVER_INFO(livox_node, "Init lds replay successfully!");
+    } else {
+      DRIVER_ERROR(livox_node, "Init lds replay failed!");
+    }
+  } else if (data_src == kSourceSynthetic) {
+    DRIVER_INFO(livox_node, "Data Source is synthetic lidars.");
+
+    std::string user_config_path;
+    livox_node.getParam("user_config_path", user_config_path);
+
+    PacketGeneratorConfig config;
+    config.lidar_num = static_cast<uint32_t>(std::max(synthetic_lidar_num, 1));
+    config.dev_type = static_cast<uint8_t>(synthetic_dev_type);
+    config.data_type = static_cast<uint8_t>(synthetic_data_type);
+    config.point_rate = static_cast<uint32_t>(std::max(synthetic_point_rate, 0));
+    config.imu_rate = static_cast<uint32_t>(std::max(synthetic_imu_rate, 0));
+    config.time_sync = (synthetic_time_sync != 0);
+    config.duration = synthetic_duration;
+
+    LdsReplay *read_synthetic = LdsReplay::GetInstance(publish_freq);
+    livox_node.lddc_ptr_->RegisterLds(static_cast<Lds *>(read_synthetic));
+    read_synthetic->SetPacketQueueSize(packet_queue_size);
+    read_synthetic->SetDecodeThreadPerLidar(decode_thread_per_lidar != 0);
+    read_synthetic->SetQueueOverflowPolicy(queue_overflow_policy, queue_block_timeout_ms);
+
+    if ((read_synthetic->InitLdsSynthetic(config, user_config_path))) {
+      DRIVER_INFO(livox_node, "Init lds synthetic successfully!");
+    } else {
+      DRIVER_ERROR(livox_node, "Init lds synthetic failed!");
+    }
   } else {
     DRIVER_ERROR(livox_node, "Invalid data src (%d), please check the launch file", data_src);
   }
@@ -127,6 +235,26 @@ DriverNode::DriverNode(const rclcpp::NodeOptions & node_options)
   double publish_freq = 10.0; /* Hz */
   int output_type = kOutputToRos;
   std::string frame_id;
+  int packet_queue_size = kDefaultRawPacketQueueSize;
+  int decode_thread_per_lidar = 0;
+  int xfer_format_mask = 0;
+  int pointcloud2_layout = kPointCloud2LayoutXyzrtlt;
+  int queue_overflow_policy = kQueueDropNewest;
+  int queue_block_timeout_ms = kDefaultQueueBlockTimeoutMs;
+  int use_loaned_messages = 0;
+  int use_intra_process_comms = 0;
+  int imu_direct_publish = 0;
+  double lvx_replay_rate = 1.0;
+  std::string packet_record_path;
+  std::string packet_replay_path;
+  double packet_replay_rate = 1.0;
+  int synthetic_lidar_num = 1;
+  int synthetic_dev_type = LivoxLidarDeviceType::kLivoxLidarTypeMid360;
+  int synthetic_data_type = kLivoxLidarCartesianCoordinateHighData;
+  int synthetic_point_rate = 0;
+  int synthetic_imu_rate = kDefaultSyntheticImuRate;
+  int synthetic_time_sync = 1;
+  double synthetic_duration = 0.0;
 
   this->declare_parameter("xfer_format", xfer_format);
   this->declare_parameter("multi_topic", 0);
@@ -137,6 +265,26 @@ DriverNode::DriverNode(const rclcpp::NodeOptions & node_options)
   this->declare_parameter("user_config_path", "path_default");
   this->declare_parameter("cmdline_input_bd_code", "000000000000001");
   this->declare_parameter("lvx_file_path", "/home/livox/livox_test.lvx");
+  this->declare_parameter("packet_queue_size", packet_queue_size);
+  this->declare_parameter("decode_thread_per_lidar", decode_thread_per_lidar);
+  this->declare_parameter("xfer_format_mask", xfer_format_mask);
+  this->declare_parameter("pointcloud2_layout", pointcloud2_layout);
+  this->declare_parameter("queue_overflow_policy", queue_overflow_policy);
+  this->declare_parameter("queue_block_timeout_ms", queue_block_timeout_ms);
+  this->declare_parameter("use_loaned_messages", use_loaned_messages);
+  this->declare_parameter("use_intra_process_comms", use_intra_process_comms);
+  this->declare_parameter("imu_direct_publish", imu_direct_publish);
+  this->declare_parameter("lvx_replay_rate", lvx_replay_rate);
+  this->declare_parameter("packet_record_path", "");
+  this->declare_parameter("packet_replay_path", "");
+  this->declare_parameter("packet_replay_rate", packet_replay_rate);
+  this->declare_parameter("synthetic_lidar_num", synthetic_lidar_num);
+  this->declare_parameter("synthetic_dev_type", synthetic_dev_type);
+  this->declare_parameter("synthetic_data_type", synthetic_data_type);
+  this->declare_parameter("synthetic_point_rate", synthetic_point_rate);
+  this->declare_parameter("synthetic_imu_rate", synthetic_imu_rate);
+  this->declare_parameter("synthetic_time_sync", synthetic_time_sync);
+  this->declare_parameter("synthetic_duration", synthetic_duration);
 
   this->get_parameter("xfer_format", xfer_format);
   this->get_parameter("multi_topic", multi_topic);
@@ -144,6 +292,26 @@ DriverNode::DriverNode(const rclcpp::NodeOptions & node_options)
   this->get_parameter("publish_freq", publish_freq);
   this->get_parameter("output_data_type", output_type);
   this->get_parameter("frame_id", frame_id);
+  this->get_parameter("packet_queue_size", packet_queue_size);
+  this->get_parameter("decode_thread_per_lidar", decode_thread_per_lidar);
+  this->get_parameter("xfer_format_mask", xfer_format_mask);
+  this->get_parameter("pointcloud2_layout", pointcloud2_layout);
+  this->get_parameter("queue_overflow_policy", queue_overflow_policy);
+  this->get_parameter("queue_block_timeout_ms", queue_block_timeout_ms);
+  this->get_parameter("use_loaned_messages", use_loaned_messages);
+  this->get_parameter("use_intra_process_comms", use_intra_process_comms);
+  this->get_parameter("imu_direct_publish", imu_direct_publish);
+  this->get_parameter("lvx_replay_rate", lvx_replay_rate);
+  this->get_parameter("packet_record_path", packet_record_path);
+  this->get_parameter("packet_replay_path", packet_replay_path);
+  this->get_parameter("packet_replay_rate", packet_replay_rate);
+  this->get_parameter("synthetic_lidar_num", synthetic_lidar_num);
+  this->get_parameter("synthetic_dev_type", synthetic_dev_type);
+  this->get_parameter("synthetic_data_type", synthetic_data_type);
+  this->get_parameter("synthetic_point_rate", synthetic_point_rate);
+  this->get_parameter("synthetic_imu_rate", synthetic_imu_rate);
+  this->get_parameter("synthetic_time_sync", synthetic_time_sync);
+  this->get_parameter("synthetic_duration", synthetic_duration);
 
   if (publish_freq > 100.0) {
     publish_freq = 100.0;
@@ -158,6 +326,12 @@ DriverNode::DriverNode(const rclcpp::NodeOptions & node_options)
   /** Lidar data distribute control and lidar data source set */
   lddc_ptr_ = std::make_unique<Lddc>(xfer_format, multi_topic, data_src, output_type, publish_freq, frame_id);
   lddc_ptr_->SetRosNode(this);
+  lddc_ptr_->SetXferFormatMask(xfer_format_mask);
+  lddc_ptr_->SetPointCloud2Layout(pointcloud2_layout);
+  lddc_ptr_->SetImuDirectPublish(imu_direct_publish != 0);
+  lddc_ptr_->SetUseLoanedMessages(use_loaned_messages != 0);
+  // also on when a component container loads us with use_intra_process_comms
+  lddc_ptr_->SetUseIntraProcessComms(use_intra_process_comms != 0 || node_options.use_intra_process_comms());
 
   if (data_src == kSourceRawLidar) {
     DRIVER_INFO(*this, "Data Source is raw lidar.");
@@ -171,12 +345,78 @@ DriverNode::DriverNode(const rclcpp::NodeOptions & node_options)
 
     LdsLidar *read_lidar = LdsLidar::GetInstance(publish_freq);
     lddc_ptr_->RegisterLds(static_cast<Lds *>(read_lidar));
+    read_lidar->SetPacketQueueSize(packet_queue_size);
+    read_lidar->SetDecodeThreadPerLidar(decode_thread_per_lidar != 0);
+    read_lidar->SetQueueOverflowPolicy(queue_overflow_policy, queue_block_timeout_ms);
+    read_lidar->SetPacketRecordPath(packet_record_path);
 
     if ((read_lidar->InitLdsLidar(user_config_path))) {
       DRIVER_INFO(*this, "Init lds lidar success!");
     } else {
       DRIVER_ERROR(*this, "Init lds lidar fail!");
     }
+  } else if (data_src == kSourceLvxFile) {
+    DRIVER_INFO(*this, "Data Source is lvx file.");
+
+    std::string lvx_file_path;
+    this->get_parameter("lvx_file_path", lvx_file_path);
+    DRIVER_INFO(*this, "Lvx file : %s", lvx_file_path.c_str());
+
+    LdsLvx *read_lvx = LdsLvx::GetInstance(publish_freq);
+    lddc_ptr_->RegisterLds(static_cast<Lds *>(read_lvx));
+    read_lvx->SetQueueOverflowPolicy(queue_overflow_policy, queue_block_timeout_ms);
+    read_lvx->SetReplayRate(lvx_replay_rate);
+
+    if ((read_lvx->InitLdsLvx(lvx_file_path))) {
+      DRIVER_INFO(*this, "Init lds lvx success!");
+    } else {
+      DRIVER_ERROR(*this, "Init lds lvx fail!");
+    }
+  } else if (data_src == kSourcePacketFile) {
+    DRIVER_INFO(*this, "Data Source is packet file.");
+
+    std::string user_config_path;
+    this->get_parameter("user_config_path", user_config_path);
+    DRIVER_INFO(*this, "Packet file : %s", packet_replay_path.c_str());
+
+    LdsReplay *read_replay = LdsReplay::GetInstance(publish_freq);
+    lddc_ptr_->RegisterLds(static_cast<Lds *>(read_replay));
+    read_replay->SetPacketQueueSize(packet_queue_size);
+    read_replay->SetDecodeThreadPerLidar(decode_thread_per_lidar != 0);
+    read_replay->SetQueueOverflowPolicy(queue_overflow_policy, queue_block_timeout_ms);
+    read_replay->SetReplayRate(packet_replay_rate);
+
+    if ((read_replay->InitLdsReplay(packet_replay_path, user_config_path))) {
+      DRIVER_INFO(*this, "Init lds replay success!");
+    } else {
+      DRIVER_ERROR(*this, "Init lds replay fail!");
+    }
+  } else if (data_src == kSourceSynthetic) {
+    DRIVER_INFO(*this, "Data Source is synthetic lidars.");
+
+    std::string user_config_path;
+    this->get_parameter("user_config_path", user_config_path);
+
+    PacketGeneratorConfig config;
+    config.lidar_num = static_cast<uint32_t>(std::max(synthetic_lidar_num, 1));
+    config.dev_type = static_cast<uint8_t>(synthetic_dev_type);
+    config.data_type = static_cast<uint8_t>(synthetic_data_type);
+    config.point_rate = static_cast<uint32_t>(std::max(synthetic_point_rate, 0));
+    config.imu_rate = static_cast<uint32_t>(std::max(synthetic_imu_rate, 0));
+    config.time_sync = (synthetic_time_sync != 0);
+    config.duration = synthetic_duration;
+
+    LdsReplay *read_synthetic = LdsReplay::GetInstance(publish_freq);
+    lddc_ptr_->RegisterLds(static_cast<Lds *>(read_synthetic));
+    read_synthetic->SetPacketQueueSize(packet_queue_size);
+    read_synthetic->SetDecodeThreadPerLidar(decode_thread_per_lidar != 0);
+    read_synthetic->SetQueueOverflowPolicy(queue_overflow_policy, queue_block_timeout_ms);
+
+    if ((read_synthetic->InitLdsSynthetic(config, user_config_path))) {
+      DRIVER_INFO(*this, "Init lds synthetic success!");
+    } else {
+      DRIVER_ERROR(*this, "Init lds synthetic fail!");
+    }
   } else {
     DRIVER_ERROR(*this, "Invalid data src (%d), please check the launch file", data_src);
   }
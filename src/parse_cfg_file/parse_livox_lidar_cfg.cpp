@@ -102,6 +102,11 @@ bool LivoxLidarConfigParser::ParseUserConfigs(const rapidjson::Document &doc,
                   << IpNumToString(user_config.handle) << std::endl;
       }
     }
+    if (!config.HasMember("decode_cpu")) {
+      user_config.decode_cpu = -1;
+    } else {
+      user_config.decode_cpu = static_cast<int32_t>(config["decode_cpu"].GetInt());
+    }
     user_config.set_bits = 0;
     user_config.get_bits = 0;
 
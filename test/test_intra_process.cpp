@@ -0,0 +1,134 @@
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2022 Livox. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+
+// Runs DriverNode on synthetic lidars in one process with a subscriber node, intra-process
+// comms on for both. Every point cloud the subscriber receives as unique_ptr must be the very
+// message the driver published: same address as the one handed to publish().
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+#include <gtest/gtest.h>
+
+#include "include/ros_headers.h"
+#include "comm/comm.h"
+#include "driver_node.h"
+#include "lddc.h"
+
+using namespace livox_ros;
+
+namespace {
+
+typedef std::pair<uint8_t, uint64_t> MessageKey;  /**< format and header stamp in ns */
+
+std::mutex published_mutex;
+std::map<MessageKey, const void*> published;
+
+uint64_t StampToNs(const builtin_interfaces::msg::Time& stamp) {
+  return static_cast<uint64_t>(stamp.sec) * 1000000000ULL + stamp.nanosec;
+}
+
+void RecordPublished(uint8_t format, const void* msg) {
+  uint64_t stamp = 0;
+  if (kPointCloud2Msg == format) {
+    stamp = StampToNs(static_cast<const PointCloud2*>(msg)->header.stamp);
+  } else if (kLivoxCustomMsg == format) {
+    stamp = StampToNs(static_cast<const CustomMsg*>(msg)->header.stamp);
+  }
+  std::lock_guard<std::mutex> lock(published_mutex);
+  published[MessageKey(format, stamp)] = msg;
+}
+
+const void* FindPublished(uint8_t format, const builtin_interfaces::msg::Time& stamp) {
+  std::lock_guard<std::mutex> lock(published_mutex);
+  auto it = published.find(MessageKey(format, StampToNs(stamp)));
+  return (it != published.end()) ? it->second : nullptr;
+}
+
+struct ReceiveCounter {
+  std::atomic<uint32_t> received{0};
+  std::atomic<uint32_t> moved{0};
+
+  void Check(uint8_t format, const builtin_interfaces::msg::Time& stamp, const void* msg) {
+    ++received;
+    if (FindPublished(format, stamp) == msg) {
+      ++moved;
+    }
+  }
+};
+
+} // namespace
+
+TEST(IntraProcessTest, SubscriberReceivesThePublishedMessage) {
+  rclcpp::init(0, nullptr);
+  Lddc::SetMovedMessageObserver(RecordPublished);
+
+  rclcpp::NodeOptions driver_options;
+  driver_options.use_intra_process_comms(true);
+  driver_options.append_parameter_override("data_src", static_cast<int>(kSourceSynthetic));
+  driver_options.append_parameter_override("xfer_format", static_cast<int>(kPointCloud2Msg));
+  driver_options.append_parameter_override("xfer_format_mask", 1 << kLivoxCustomMsg);
+  auto driver = std::make_shared<DriverNode>(driver_options);
+
+  auto listener = std::make_shared<rclcpp::Node>("intra_process_listener",
+      rclcpp::NodeOptions().use_intra_process_comms(true));
+  ReceiveCounter cloud_counter;
+  ReceiveCounter custom_counter;
+  auto cloud_sub = listener->create_subscription<PointCloud2>("livox/lidar", 10,
+      [&cloud_counter](std::unique_ptr<PointCloud2> msg) {
+        cloud_counter.Check(kPointCloud2Msg, msg->header.stamp, msg.get());
+      });
+  auto custom_sub = listener->create_subscription<CustomMsg>("livox/lidar_custom", 10,
+      [&custom_counter](std::unique_ptr<CustomMsg> msg) {
+        custom_counter.Check(kLivoxCustomMsg, msg->header.stamp, msg.get());
+      });
+
+  rclcpp::executors::SingleThreadedExecutor executor;
+  executor.add_node(driver);
+  executor.add_node(listener);
+
+  // the driver starts distributing frames 3 s after construction
+  const uint32_t kFrames = 5;
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(20);
+  while (((cloud_counter.received < kFrames) || (custom_counter.received < kFrames)) &&
+         (std::chrono::steady_clock::now() < deadline)) {
+    executor.spin_some(std::chrono::milliseconds(100));
+  }
+
+  executor.remove_node(listener);
+  executor.remove_node(driver);
+  driver.reset();
+  Lddc::SetMovedMessageObserver(nullptr);
+  rclcpp::shutdown();
+
+  EXPECT_GE(cloud_counter.received.load(), kFrames);
+  EXPECT_EQ(cloud_counter.moved.load(), cloud_counter.received.load());
+  EXPECT_GE(custom_counter.received.load(), kFrames);
+  EXPECT_EQ(custom_counter.moved.load(), custom_counter.received.load());
+}
@@ -0,0 +1,166 @@
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2022 Livox. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+
+// The AVX2 decode kernels against the scalar kernels, with and without extrinsic and for
+// point counts that leave a tail after the 8 point blocks (skipped on cpus without AVX2),
+// and the bound on the point number of a packet.
+
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "livox_lidar_def.h"
+#include "comm/comm.h"
+#include "comm/point_decoder.h"
+
+using namespace livox_ros;
+
+namespace {
+
+typedef void (*DecodeKernel)(const RawPacket& pkt, uint32_t point_num,
+                             const PointTransform& transform, PointXyzlt* points);
+
+constexpr uint32_t kPointsPerPacket = 96;
+constexpr uint32_t kGuardPoints = 8;  /**< records past point_num that must stay untouched */
+
+template <typename RawPoint>
+RawPacket MakePacket(int32_t range) {
+  std::mt19937 rng(20230101);
+  std::uniform_int_distribution<int32_t> coord(-range, range);
+  std::uniform_int_distribution<int32_t> byte(0, 255);
+
+  RawPacket pkt;
+  memset(&pkt, 0, sizeof(pkt));
+  pkt.lidar_type = kLivoxLidarType;
+  pkt.point_num = kPointsPerPacket;
+  pkt.line_num = 4;
+  pkt.time_stamp = 1000000000ULL;
+  pkt.point_interval = 5555;
+  pkt.data_length = kPointsPerPacket * sizeof(RawPoint);
+  RawPoint* raw = reinterpret_cast<RawPoint*>(pkt.raw_data);
+  for (uint32_t i = 0; i < kPointsPerPacket; i++) {
+    raw[i].x = coord(rng);
+    raw[i].y = coord(rng);
+    raw[i].z = coord(rng);
+    raw[i].reflectivity = static_cast<uint8_t>(byte(rng));
+    raw[i].tag = static_cast<uint8_t>(byte(rng));
+  }
+  return pkt;
+}
+
+void MakeExtrinsic(ExtParameterDetailed& extrinsic) {
+  const double roll = 1.5 * PI / 180.0;
+  const double pitch = -2.0 * PI / 180.0;
+  const double yaw = 30.0 * PI / 180.0;
+  extrinsic.rotation[0][0] = cos(pitch) * cos(yaw);
+  extrinsic.rotation[0][1] = sin(roll) * sin(pitch) * cos(yaw) - cos(roll) * sin(yaw);
+  extrinsic.rotation[0][2] = cos(roll) * sin(pitch) * cos(yaw) + sin(roll) * sin(yaw);
+  extrinsic.rotation[1][0] = cos(pitch) * sin(yaw);
+  extrinsic.rotation[1][1] = sin(roll) * sin(pitch) * sin(yaw) + cos(roll) * cos(yaw);
+  extrinsic.rotation[1][2] = cos(roll) * sin(pitch) * sin(yaw) - sin(roll) * cos(yaw);
+  extrinsic.rotation[2][0] = -sin(pitch);
+  extrinsic.rotation[2][1] = sin(roll) * cos(pitch);
+  extrinsic.rotation[2][2] = cos(roll) * cos(pitch);
+  extrinsic.trans[0] = 0.12f;
+  extrinsic.trans[1] = -0.045f;
+  extrinsic.trans[2] = 0.3f;
+}
+
+std::vector<PointXyzlt> Run(DecodeKernel kernel, const RawPacket& pkt, uint32_t point_num,
+                            const PointTransform& transform) {
+  std::vector<PointXyzlt> points(point_num + kGuardPoints);
+  memset(points.data(), 0xa5, points.size() * sizeof(PointXyzlt));
+  kernel(pkt, point_num, transform, points.data());
+  return points;
+}
+
+template <typename RawPoint>
+void ExpectAvx2MatchesScalar(DecodeKernel scalar, DecodeKernel avx2, int32_t range,
+                             float unit_scale) {
+  if (!IsAvx2DecodeSupported()) {
+    GTEST_SKIP() << "AVX2 decode is not supported here";
+  }
+  RawPacket pkt = MakePacket<RawPoint>(range);
+  ExtParameterDetailed extrinsic;
+  MakeExtrinsic(extrinsic);
+  // both kernels compute in float, allow a few ulp of the largest coordinate
+  const double tolerance = range * unit_scale * 4 * 1.2e-7;
+
+  for (bool apply_extrinsic : {false, true}) {
+    PointTransform transform;
+    MakePointTransform(apply_extrinsic ? &extrinsic : nullptr, unit_scale, transform);
+    for (uint32_t point_num : {kPointsPerPacket, 91u, 9u, 7u, 1u}) {
+      SCOPED_TRACE(testing::Message() << (apply_extrinsic ? "extrinsic" : "unit scale")
+                                      << ", points " << point_num);
+      std::vector<PointXyzlt> ref = Run(scalar, pkt, point_num, transform);
+      std::vector<PointXyzlt> out = Run(avx2, pkt, point_num, transform);
+      for (uint32_t i = 0; i < point_num; i++) {
+        ASSERT_NEAR(out[i].x, ref[i].x, tolerance) << "point " << i;
+        ASSERT_NEAR(out[i].y, ref[i].y, tolerance) << "point " << i;
+        ASSERT_NEAR(out[i].z, ref[i].z, tolerance) << "point " << i;
+        ASSERT_EQ(out[i].intensity, ref[i].intensity) << "point " << i;
+        ASSERT_EQ(out[i].tag, ref[i].tag) << "point " << i;
+        ASSERT_EQ(out[i].line, ref[i].line) << "point " << i;
+        ASSERT_EQ(out[i].offset_time, ref[i].offset_time) << "point " << i;
+      }
+      // the tail must not be written past point_num
+      EXPECT_EQ(memcmp(out.data() + point_num, ref.data() + point_num,
+                       kGuardPoints * sizeof(PointXyzlt)), 0);
+    }
+  }
+}
+
+TEST(PointDecoderTest, CartesianHighAvx2MatchesScalar) {
+  ExpectAvx2MatchesScalar<LivoxLidarCartesianHighRawPoint>(DecodeCartesianHighPointsScalar,
+      DecodeCartesianHighPointsAvx2, 200000, 0.001f);
+}
+
+TEST(PointDecoderTest, CartesianLowAvx2MatchesScalar) {
+  ExpectAvx2MatchesScalar<LivoxLidarCartesianLowRawPoint>(DecodeCartesianLowPointsScalar,
+      DecodeCartesianLowPointsAvx2, 32000, 0.01f);
+}
+
+TEST(PointDecoderTest, DecodablePointNumIsBoundedByTheDataLength) {
+  RawPacket pkt = MakePacket<LivoxLidarCartesianHighRawPoint>(200000);
+  pkt.data_type = kLivoxLidarCartesianCoordinateHighData;
+  EXPECT_EQ(GetDecodablePointNum(pkt), kPointsPerPacket);
+
+  pkt.point_num = 65535;
+  EXPECT_EQ(GetDecodablePointNum(pkt), kPointsPerPacket);
+
+  pkt.data_length = 5 * sizeof(LivoxLidarCartesianHighRawPoint) + 3;
+  EXPECT_EQ(GetDecodablePointNum(pkt), 5u);
+
+  pkt.data_type = kLivoxLidarCartesianCoordinateLowData;
+  EXPECT_EQ(GetDecodablePointNum(pkt), 9u);
+
+  pkt.data_type = kLivoxLidarSphericalCoordinateData + 1;
+  EXPECT_EQ(GetDecodablePointNum(pkt), 0u);
+}
+
+} // namespace
@@ -0,0 +1,306 @@
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2022 Livox. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+
+// Round trip of decoded packets through the integer PointCloud2 layouts. Every point the
+// layout can hold must come back within half a quantum of the float XYZI layout, the rest
+// must be dropped, and every field must lie inside the record.
+
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "livox_lidar_def.h"
+#include "comm/comm.h"
+#include "comm/point_decoder.h"
+#include "comm/pointcloud2_layout.h"
+
+using namespace livox_ros;
+
+namespace {
+
+constexpr uint32_t kPointsPerPacket = 96;
+constexpr uint32_t kPacketNum = 64;
+constexpr int32_t kQ16Limit = 32767;
+constexpr int32_t kI32Limit = 2147483520;
+
+uint32_t GetFieldSize(uint8_t datatype) {
+  switch (datatype) {
+    case kPointFieldInt8:
+    case kPointFieldUint8:
+      return 1;
+    case kPointFieldInt16:
+    case kPointFieldUint16:
+      return 2;
+    case kPointFieldFloat64:
+      return 8;
+    default:
+      return 4;
+  }
+}
+
+RawPacket MakePacket(uint8_t data_type) {
+  RawPacket pkt;
+  memset(&pkt, 0, sizeof(pkt));
+  pkt.lidar_type = kLivoxLidarType;
+  pkt.data_type = data_type;
+  pkt.point_num = kPointsPerPacket;
+  pkt.line_num = 4;
+  pkt.time_stamp = 1000000000ULL;
+  pkt.point_interval = 500;
+  return pkt;
+}
+
+/** random points of data_type within 200 m, the range of a real lidar */
+std::vector<RawPacket> MakePackets(uint8_t data_type) {
+  std::mt19937 rng(20230101);
+  std::uniform_int_distribution<int32_t> mm(-200000, 200000);
+  std::uniform_int_distribution<int32_t> cm(-20000, 20000);
+  std::uniform_int_distribution<uint32_t> depth(0, 200000);
+  std::uniform_int_distribution<uint32_t> theta(0, 18000);
+  std::uniform_int_distribution<uint32_t> phi(0, 35999);
+  std::uniform_int_distribution<uint32_t> byte(0, 255);
+
+  std::vector<RawPacket> packets;
+  for (uint32_t n = 0; n < kPacketNum; n++) {
+    RawPacket pkt = MakePacket(data_type);
+    for (uint32_t i = 0; i < kPointsPerPacket; i++) {
+      if (data_type == kLivoxLidarCartesianCoordinateHighData) {
+        auto* raw = reinterpret_cast<LivoxLidarCartesianHighRawPoint*>(pkt.raw_data);
+        raw[i] = {mm(rng), mm(rng), mm(rng), static_cast<uint8_t>(byte(rng)),
+                  static_cast<uint8_t>(byte(rng))};
+      } else if (data_type == kLivoxLidarCartesianCoordinateLowData) {
+        auto* raw = reinterpret_cast<LivoxLidarCartesianLowRawPoint*>(pkt.raw_data);
+        raw[i] = {static_cast<int16_t>(cm(rng)), static_cast<int16_t>(cm(rng)),
+                  static_cast<int16_t>(cm(rng)), static_cast<uint8_t>(byte(rng)),
+                  static_cast<uint8_t>(byte(rng))};
+      } else {
+        auto* raw = reinterpret_cast<LivoxLidarSpherPoint*>(pkt.raw_data);
+        raw[i] = {depth(rng), static_cast<uint16_t>(theta(rng)), static_cast<uint16_t>(phi(rng)),
+                  static_cast<uint8_t>(byte(rng)), static_cast<uint8_t>(byte(rng))};
+      }
+    }
+    packets.push_back(pkt);
+  }
+  return packets;
+}
+
+float GetUnitScale(uint8_t data_type) {
+  return (data_type == kLivoxLidarCartesianCoordinateLowData) ? 0.01f : 0.001f;
+}
+
+uint32_t GetRawPointSize(uint8_t data_type) {
+  if (data_type == kLivoxLidarCartesianCoordinateHighData) {
+    return sizeof(LivoxLidarCartesianHighRawPoint);
+  } else if (data_type == kLivoxLidarCartesianCoordinateLowData) {
+    return sizeof(LivoxLidarCartesianLowRawPoint);
+  }
+  return sizeof(LivoxLidarSpherPoint);
+}
+
+/** decodes with the kernel the driver picks for the data type */
+std::vector<PointXyzlt> Decode(std::vector<RawPacket>& packets, bool apply_extrinsic) {
+  ExtParameterDetailed extrinsic;
+  const double roll = 1.5 * PI / 180.0;
+  const double pitch = -2.0 * PI / 180.0;
+  const double yaw = 30.0 * PI / 180.0;
+  extrinsic.rotation[0][0] = cos(pitch) * cos(yaw);
+  extrinsic.rotation[0][1] = sin(roll) * sin(pitch) * cos(yaw) - cos(roll) * sin(yaw);
+  extrinsic.rotation[0][2] = cos(roll) * sin(pitch) * cos(yaw) + sin(roll) * sin(yaw);
+  extrinsic.rotation[1][0] = cos(pitch) * sin(yaw);
+  extrinsic.rotation[1][1] = sin(roll) * sin(pitch) * sin(yaw) + cos(roll) * cos(yaw);
+  extrinsic.rotation[1][2] = cos(roll) * sin(pitch) * sin(yaw) - sin(roll) * cos(yaw);
+  extrinsic.rotation[2][0] = -sin(pitch);
+  extrinsic.rotation[2][1] = sin(roll) * cos(pitch);
+  extrinsic.rotation[2][2] = cos(roll) * cos(pitch);
+  extrinsic.trans[0] = 0.12f;
+  extrinsic.trans[1] = -0.045f;
+  extrinsic.trans[2] = 0.3f;
+
+  std::vector<PointXyzlt> points;
+  for (auto& pkt : packets) {
+    pkt.data_length = pkt.point_num * GetRawPointSize(pkt.data_type);
+    PointTransform transform;
+    MakePointTransform(apply_extrinsic ? &extrinsic : nullptr, GetUnitScale(pkt.data_type), transform);
+    PointDecodeFunc decode = GetPointDecodeFunc(pkt.data_type, apply_extrinsic, false);
+    size_t offset = points.size();
+    points.resize(offset + pkt.point_num);
+    points.resize(offset + decode(pkt, transform, points.data() + offset));
+  }
+  return points;
+}
+
+/** the records the layout writes for points, data is cut to the points it kept */
+std::vector<uint8_t> Fill(uint8_t layout_type, const std::vector<PointXyzlt>& points) {
+  const PointCloud2Layout* layout = GetPointCloud2Layout(layout_type);
+  std::vector<uint8_t> data(points.size() * layout->point_step);
+  uint32_t num = layout->fill(points.data(), static_cast<uint32_t>(points.size()), 0, data.data());
+  data.resize(num * layout->point_step);
+  return data;
+}
+
+/** compares the integer records against the float XYZI records of the same points */
+template <typename Record>
+void ExpectRoundTrip(const std::vector<PointXyzlt>& points, uint8_t layout_type, int32_t limit) {
+  const double scale = GetPointCloud2Layout(layout_type)->scale;
+  std::vector<uint8_t> xyzi_data = Fill(kPointCloud2LayoutXyzi, points);
+  std::vector<uint8_t> data = Fill(layout_type, points);
+  const PointCloud2Xyzi* xyzi = reinterpret_cast<const PointCloud2Xyzi*>(xyzi_data.data());
+  const Record* records = reinterpret_cast<const Record*>(data.data());
+  const size_t record_num = data.size() / sizeof(Record);
+
+  size_t n = 0;
+  for (size_t i = 0; i < points.size(); i++) {
+    const float expected[3] = {xyzi[i].x, xyzi[i].y, xyzi[i].z};
+    if ((std::fabs(expected[0] / scale) > limit) || (std::fabs(expected[1] / scale) > limit) ||
+        (std::fabs(expected[2] / scale) > limit)) {
+      continue;  // dropped
+    }
+    ASSERT_LT(n, record_num) << "point " << i;
+    const Record& record = records[n++];
+    const int32_t actual[3] = {record.x, record.y, record.z};
+    for (int k = 0; k < 3; k++) {
+      // half a quantum, plus the float rounding of meter / scale
+      double tolerance = scale * 0.5 + std::fabs(expected[k]) * 4 * 1.2e-7;
+      ASSERT_NEAR(actual[k] * scale, expected[k], tolerance) << "point " << i << " axis " << k;
+    }
+    ASSERT_EQ(record.intensity, static_cast<uint8_t>(xyzi[i].intensity));
+    ASSERT_EQ(record.line, points[i].line);
+  }
+  EXPECT_EQ(n, record_num);
+}
+
+void ExpectIntegerLayoutsMatchFloatXyzi(uint8_t data_type) {
+  std::vector<RawPacket> packets = MakePackets(data_type);
+  for (bool apply_extrinsic : {false, true}) {
+    SCOPED_TRACE(apply_extrinsic ? "extrinsic" : "unit scale");
+    std::vector<PointXyzlt> points = Decode(packets, apply_extrinsic);
+    ASSERT_EQ(points.size(), kPacketNum * kPointsPerPacket);
+    ExpectRoundTrip<PointCloud2XyziQ16>(points, kPointCloud2LayoutXyziQ16, kQ16Limit);
+    ExpectRoundTrip<PointCloud2XyziI32>(points, kPointCloud2LayoutXyziI32, kI32Limit);
+    // 200 m fits both layouts, no point may be lost
+    EXPECT_EQ(Fill(kPointCloud2LayoutXyziQ16, points).size(), points.size() * sizeof(PointCloud2XyziQ16));
+    EXPECT_EQ(Fill(kPointCloud2LayoutXyziI32, points).size(), points.size() * sizeof(PointCloud2XyziI32));
+  }
+}
+
+TEST(PointCloud2LayoutTest, CartesianHighMatchesFloatXyzi) {
+  ExpectIntegerLayoutsMatchFloatXyzi(kLivoxLidarCartesianCoordinateHighData);
+}
+
+TEST(PointCloud2LayoutTest, CartesianLowMatchesFloatXyzi) {
+  ExpectIntegerLayoutsMatchFloatXyzi(kLivoxLidarCartesianCoordinateLowData);
+}
+
+TEST(PointCloud2LayoutTest, SphericalMatchesFloatXyzi) {
+  ExpectIntegerLayoutsMatchFloatXyzi(kLivoxLidarSphericalCoordinateData);
+}
+
+TEST(PointCloud2LayoutTest, KeepsTheRawSensorUnits) {
+  // without extrinsic XYZI_I32 gives back the mm of the high data, XYZI_Q16 the cm of the low data
+  std::vector<RawPacket> high = MakePackets(kLivoxLidarCartesianCoordinateHighData);
+  std::vector<uint8_t> i32_data = Fill(kPointCloud2LayoutXyziI32, Decode(high, false));
+  const PointCloud2XyziI32* i32 = reinterpret_cast<const PointCloud2XyziI32*>(i32_data.data());
+  ASSERT_EQ(i32_data.size(), kPacketNum * kPointsPerPacket * sizeof(PointCloud2XyziI32));
+  for (uint32_t n = 0; n < kPacketNum; n++) {
+    auto* raw = reinterpret_cast<const LivoxLidarCartesianHighRawPoint*>(high[n].raw_data);
+    for (uint32_t i = 0; i < kPointsPerPacket; i++) {
+      const PointCloud2XyziI32& point = i32[n * kPointsPerPacket + i];
+      ASSERT_EQ(point.x, raw[i].x);
+      ASSERT_EQ(point.y, raw[i].y);
+      ASSERT_EQ(point.z, raw[i].z);
+    }
+  }
+
+  std::vector<RawPacket> low = MakePackets(kLivoxLidarCartesianCoordinateLowData);
+  std::vector<uint8_t> q16_data = Fill(kPointCloud2LayoutXyziQ16, Decode(low, false));
+  const PointCloud2XyziQ16* q16 = reinterpret_cast<const PointCloud2XyziQ16*>(q16_data.data());
+  ASSERT_EQ(q16_data.size(), kPacketNum * kPointsPerPacket * sizeof(PointCloud2XyziQ16));
+  for (uint32_t n = 0; n < kPacketNum; n++) {
+    auto* raw = reinterpret_cast<const LivoxLidarCartesianLowRawPoint*>(low[n].raw_data);
+    for (uint32_t i = 0; i < kPointsPerPacket; i++) {
+      const PointCloud2XyziQ16& point = q16[n * kPointsPerPacket + i];
+      ASSERT_EQ(point.x, raw[i].x);
+      ASSERT_EQ(point.y, raw[i].y);
+      ASSERT_EQ(point.z, raw[i].z);
+    }
+  }
+}
+
+TEST(PointCloud2LayoutTest, DropsPointsOutOfRange) {
+  // 400 m is past the +-327.67 m of XYZI_Q16, 2147 km past XYZI_I32
+  RawPacket pkt = MakePacket(kLivoxLidarCartesianCoordinateHighData);
+  auto* raw = reinterpret_cast<LivoxLidarCartesianHighRawPoint*>(pkt.raw_data);
+  raw[0] = {1000, -2000, 3000, 10, 0};
+  raw[1] = {400000, 0, 0, 20, 0};
+  raw[2] = {-327660, 327660, -4, 30, 0};
+  raw[3] = {2147483647, -2147483647, 0, 40, 0};
+  raw[4] = {0, 0, -327680, 50, 0};
+  pkt.point_num = 5;
+  std::vector<RawPacket> packets = {pkt};
+  std::vector<PointXyzlt> points = Decode(packets, false);
+  ASSERT_EQ(points.size(), 5u);
+
+  std::vector<uint8_t> q16_data = Fill(kPointCloud2LayoutXyziQ16, points);
+  const PointCloud2XyziQ16* q16 = reinterpret_cast<const PointCloud2XyziQ16*>(q16_data.data());
+  ASSERT_EQ(q16_data.size(), 2 * sizeof(PointCloud2XyziQ16));
+  EXPECT_EQ(q16[0].x, 100);
+  EXPECT_EQ(q16[0].y, -200);
+  EXPECT_EQ(q16[0].z, 300);
+  EXPECT_EQ(q16[0].intensity, 10);
+  EXPECT_EQ(q16[1].x, -32766);
+  EXPECT_EQ(q16[1].y, 32766);
+  EXPECT_EQ(q16[1].z, 0);
+  EXPECT_EQ(q16[1].intensity, 30);
+
+  std::vector<uint8_t> i32_data = Fill(kPointCloud2LayoutXyziI32, points);
+  const PointCloud2XyziI32* i32 = reinterpret_cast<const PointCloud2XyziI32*>(i32_data.data());
+  ASSERT_EQ(i32_data.size(), 4 * sizeof(PointCloud2XyziI32));
+  EXPECT_EQ(i32[1].x, 400000);
+  EXPECT_EQ(i32[2].z, -4);
+  EXPECT_EQ(i32[3].z, -327680);
+  EXPECT_EQ(i32[3].intensity, 50);
+}
+
+TEST(PointCloud2LayoutTest, FieldsLieInsideTheRecord) {
+  for (uint8_t type = 0; type < kPointCloud2LayoutUndef; type++) {
+    const PointCloud2Layout* layout = GetPointCloud2Layout(type);
+    ASSERT_NE(layout, nullptr);
+    SCOPED_TRACE(layout->name);
+    for (uint32_t i = 0; i < layout->field_num; i++) {
+      const PointCloud2FieldDesc& field = layout->fields[i];
+      EXPECT_LE(field.offset + GetFieldSize(field.datatype), layout->point_step) << field.name;
+    }
+    // only the integer layouts have a quantum, and their coordinates are integer fields
+    EXPECT_EQ(layout->scale > 0.0f, layout->fields[0].datatype != kPointFieldFloat32);
+  }
+  EXPECT_EQ(GetPointCloud2Layout(kPointCloud2LayoutXyziQ16)->point_step, 8u);
+  EXPECT_EQ(GetPointCloud2Layout(kPointCloud2LayoutXyziI32)->point_step, 14u);
+  EXPECT_EQ(GetPointCloud2Layout(kPointCloud2LayoutUndef), nullptr);
+}
+
+} // namespace